@@ -0,0 +1,439 @@
+#pragma once
+
+#include <threading.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// memory bandwidth and latency by thread count, working set, access pattern and thread placement
+// every thread walks a buffer of its own (allocated and first touched by that thread, so it lands on its numa node)
+// for config::duration, the threads of one case start together
+
+namespace memory_bench
+{
+
+	constexpr std::size_t line_size = 64;
+
+	enum class pattern
+	{
+		sequential, // every word in order, what prefetchers like best
+		strided, // one word every config::stride bytes
+		random_chase, // one dependent load per cache line in a random cycle, the load latency
+	};
+
+	enum class pinning
+	{
+		none,
+		compact, // thread i on cpu i
+		spread, // threads spaced evenly over the cpus
+	};
+
+	inline const char* name(const pattern p)
+	{
+		switch (p)
+		{
+			case pattern::sequential:
+				return "sequential";
+			case pattern::strided:
+				return "strided";
+			case pattern::random_chase:
+				return "random_chase";
+		}
+		return "?";
+	}
+
+	inline const char* name(const pinning p)
+	{
+		switch (p)
+		{
+			case pinning::none:
+				return "none";
+			case pinning::compact:
+				return "compact";
+			case pinning::spread:
+				return "spread";
+		}
+		return "?";
+	}
+
+	inline bool parse(const std::string& s, pattern& out)
+	{
+		for (pattern p : { pattern::sequential, pattern::strided, pattern::random_chase })
+		{
+			if (s == name(p))
+			{
+				out = p;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline bool parse(const std::string& s, pinning& out)
+	{
+		for (pinning p : { pinning::none, pinning::compact, pinning::spread })
+		{
+			if (s == name(p))
+			{
+				out = p;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// "4096", "32K", "8M", "1G"
+	inline bool parse(const std::string& s, std::size_t& out)
+	{
+		char*			   end = nullptr;
+		unsigned long long v = std::strtoull(s.c_str(), &end, 10);
+		if (end == s.c_str())
+			return false;
+		std::string unit(end);
+		if (unit == "K" || unit == "k")
+			v <<= 10;
+		else if (unit == "M" || unit == "m")
+			v <<= 20;
+		else if (unit == "G" || unit == "g")
+			v <<= 30;
+		else if (unit.empty() == false)
+			return false;
+		out = std::size_t(v);
+		return true;
+	}
+
+	template <class T>
+	// comma separated list
+	inline bool parse(const std::string& s, std::vector<T>& out)
+	{
+		out.clear();
+		std::istringstream in(s);
+		std::string		   item;
+		while (std::getline(in, item, ','))
+		{
+			T v;
+			if (parse(item, v) == false)
+				return false;
+			out.push_back(v);
+		}
+		return out.empty() == false;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	struct config
+	{
+		std::vector<std::size_t> threads;
+		std::vector<std::size_t> working_sets; // bytes per thread
+		std::vector<pattern>	 patterns { pattern::sequential, pattern::strided, pattern::random_chase };
+		std::vector<pinning>	 pinnings { pinning::none, pinning::compact, pinning::spread };
+
+		std::size_t				  stride = 256; // bytes, for pattern::strided
+		std::chrono::milliseconds duration { 200 }; // per case
+		std::size_t				  cpus = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+
+		// powers of two up to the cpu count; working sets from L1 sized to well past any last level cache
+		static config defaults()
+		{
+			config c;
+			for (std::size_t t = 1; t < c.cpus; t *= 2)
+				c.threads.push_back(t);
+			c.threads.push_back(c.cpus);
+			c.working_sets = { std::size_t(16) << 10, std::size_t(256) << 10, std::size_t(4) << 20, std::size_t(32) << 20, std::size_t(256) << 20 };
+			return c;
+		}
+
+		// cpu of thread index out of thread_count, or -1 to leave it to the scheduler
+		inline int64_t cpu_for(const pinning p, const std::size_t index, const std::size_t thread_count) const
+		{
+			switch (p)
+			{
+				case pinning::compact:
+					return int64_t(index % cpus);
+				case pinning::spread:
+					return int64_t((index * std::max<std::size_t>(1, cpus / thread_count)) % cpus);
+				default:
+					return -1;
+			}
+		}
+	};
+
+	struct result
+	{
+		std::size_t threads = 0;
+		std::size_t working_set = 0;
+		pattern		access = pattern::sequential;
+		pinning		placement = pinning::none;
+
+		uint64_t accesses = 0; // reads of all threads
+		double	 seconds = 0.0; // of the slowest thread
+		double	 ns_per_access = 0.0; // mean over the threads
+		double	 gb_per_s = 0.0; // all threads, bytes of the cache lines read (at most one line per access)
+
+		uint64_t			   involuntary_switches = 0; // while measuring, all threads
+		uint64_t			   migrations = 0;
+		threading::perf_sample counters; // all threads, see threading::perf_counters
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	namespace detail
+	{
+		constexpr std::size_t line_words = line_size / sizeof(uint64_t);
+
+		// bytes a read brings in
+		inline std::size_t bytes_per_access(const pattern access, const std::size_t stride)
+		{
+			if (access == pattern::sequential)
+				return sizeof(uint64_t);
+			if (access == pattern::strided)
+				return std::min(line_size, std::max(sizeof(uint64_t), stride));
+			return line_size;
+		}
+
+		inline std::atomic<uint64_t>& sink()
+		{
+			static std::atomic<uint64_t> s { 0 }; // keeps the reads alive
+			return s;
+		}
+
+		// one thread's buffer and position, walked in chunks so the clock is read rarely
+		struct walker
+		{
+			walker(const pattern p, const std::size_t bytes, const std::size_t stride)
+				: access(p)
+				, words(std::max(line_size, bytes) / sizeof(uint64_t))
+				, storage(new uint64_t[words + line_words])
+			{
+				const uintptr_t misalign = reinterpret_cast<uintptr_t>(storage.get()) % line_size;
+				data = storage.get() + (misalign == 0 ? 0 : (line_size - misalign) / sizeof(uint64_t));
+				step = std::min(words, std::max<std::size_t>(1, stride / sizeof(uint64_t)));
+
+				for (std::size_t i = 0; i < words; i++)
+					data[i] = i;
+				if (access == pattern::random_chase)
+				{
+					// a single cycle through all lines (Sattolo), each line holds the word index of the next one
+					const std::size_t		 lines = words / line_words;
+					std::vector<std::size_t> order(lines);
+					for (std::size_t i = 0; i < lines; i++)
+						order[i] = i;
+					std::mt19937_64 rng(lines);
+					for (std::size_t i = lines - 1; i > 0; i--)
+						std::swap(order[i], order[std::uniform_int_distribution<std::size_t>(0, i - 1)(rng)]);
+					for (std::size_t i = 0; i < lines; i++)
+						data[order[i] * line_words] = order[(i + 1) % lines] * line_words;
+					pos = order[0] * line_words;
+				}
+			}
+
+			// reads that touch every line once
+			inline uint64_t reads_per_pass() const
+			{
+				if (access == pattern::sequential)
+					return words;
+				if (access == pattern::strided)
+					return std::max<uint64_t>(words / step, 1) * std::max<uint64_t>(step / line_words, 1);
+				return words / line_words;
+			}
+
+			void run(uint64_t reads)
+			{
+				uint64_t s = 0;
+				switch (access)
+				{
+					case pattern::sequential:
+						while (reads > 0)
+						{
+							const std::size_t n = std::size_t(std::min<uint64_t>(reads, words - pos));
+							for (std::size_t i = 0; i < n; i++)
+								s += data[pos + i];
+							pos = pos + n == words ? 0 : pos + n;
+							reads -= n;
+						}
+						break;
+					case pattern::strided:
+						for (; reads > 0; reads--)
+						{
+							s += data[pos];
+							pos += step;
+							if (pos >= words)
+								pos = (pos - words + line_words) % step; // the next pass reads the lines this one skipped
+						}
+						break;
+					case pattern::random_chase:
+						for (; reads > 0; reads--)
+							pos = std::size_t(data[pos]);
+						s = pos;
+						break;
+				}
+				sink().fetch_add(s, std::memory_order_relaxed);
+			}
+
+			const pattern				access;
+			const std::size_t			words;
+			std::unique_ptr<uint64_t[]> storage;
+			uint64_t*					data = nullptr;
+			std::size_t					step = 1;
+			std::size_t					pos = 0;
+		};
+
+		struct thread_result
+		{
+			uint64_t			   reads = 0;
+			double				   seconds = 0.0;
+			uint64_t			   involuntary_switches = 0;
+			uint64_t			   migrations = 0;
+			threading::perf_sample counters;
+		};
+	}
+
+	inline result run_case(const config& c, const std::size_t thread_count, const std::size_t working_set, const pattern access, const pinning placement)
+	{
+		constexpr uint64_t chunk = 16384; // reads between clock checks
+		THREADING_ASSERT(thread_count > 0);
+
+		std::vector<detail::thread_result> per_thread(thread_count);
+		threading::latch				   start(thread_count);
+		{
+			threading::thread_group	 threads;
+			std::atomic<std::size_t> next_index { 0 };
+			threads.spawn_named("memory_bench", thread_count, [&]() {
+				const std::size_t index = next_index++;
+				const int64_t	  cpu = c.cpu_for(placement, index, thread_count);
+				if (cpu >= 0)
+					threading::utils::lock_current_thread_to_core(std::size_t(cpu));
+
+				detail::walker		   w(access, working_set, c.stride);
+				detail::thread_result& r = per_thread[index];
+				w.run(w.reads_per_pass()); // warm up, the buffer is in the caches it fits in
+				start.arrive_and_wait();
+
+				const threading::thread_stats before = threading::thread_group::current_thread_stats();
+				{
+					threading::perf_scope _(r.counters);
+					const auto			  begin = std::chrono::steady_clock::now();
+					auto				  now = begin;
+					do
+					{
+						w.run(chunk);
+						r.reads += chunk;
+						now = std::chrono::steady_clock::now();
+					} while (now - begin < c.duration);
+					r.seconds = std::chrono::duration<double>(now - begin).count();
+				}
+				const threading::thread_stats after = threading::thread_group::current_thread_stats();
+				r.involuntary_switches = after.involuntary_switches - before.involuntary_switches;
+				r.migrations = after.migrations - before.migrations;
+			});
+		}
+
+		result res;
+		res.threads = thread_count;
+		res.working_set = working_set;
+		res.access = access;
+		res.placement = placement;
+
+		const std::size_t bytes_per_access = detail::bytes_per_access(access, c.stride);
+		for (const detail::thread_result& r : per_thread)
+		{
+			res.accesses += r.reads;
+			res.seconds = std::max(res.seconds, r.seconds);
+			res.ns_per_access += r.seconds * 1e9 / double(r.reads) / double(thread_count);
+			res.gb_per_s += double(r.reads) * double(bytes_per_access) / r.seconds / 1e9;
+			res.involuntary_switches += r.involuntary_switches;
+			res.migrations += r.migrations;
+			res.counters += r.counters;
+		}
+		return res;
+	}
+
+	template <class F>
+	// every combination of the config, _progress(const result&) after each case
+	inline std::vector<result> run(const config& c, const F& _progress)
+	{
+		std::vector<result> results;
+		for (const pinning placement : c.pinnings)
+		{
+			for (const std::size_t thread_count : c.threads)
+			{
+				for (const pattern access : c.patterns)
+				{
+					for (const std::size_t working_set : c.working_sets)
+					{
+						results.push_back(run_case(c, thread_count, working_set, access, placement));
+						_progress(results.back());
+					}
+				}
+			}
+		}
+		return results;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	inline void write_table_header(std::ostream& out)
+	{
+		out << std::setw(8) << "pinning" << std::setw(8) << "threads" << std::setw(14) << "pattern" << std::setw(12) << "set KB" << std::setw(12)
+			<< "ns/access" << std::setw(10) << "GB/s" << std::setw(8) << "ipc" << std::setw(12) << "preempted" << std::setw(12) << "migrations"
+			<< "\n";
+	}
+
+	inline void write_table_row(std::ostream& out, const result& r)
+	{
+		const auto flags = out.flags();
+		const auto precision = out.precision();
+		out << std::fixed << std::setprecision(2) << std::setw(8) << name(r.placement) << std::setw(8) << r.threads << std::setw(14) << name(r.access)
+			<< std::setw(12) << r.working_set / 1024 << std::setw(12) << r.ns_per_access << std::setw(10) << r.gb_per_s << std::setw(8);
+		if (r.counters.has(threading::perf_event::cycles) && r.counters.has(threading::perf_event::instructions))
+			out << r.counters.ipc();
+		else
+			out << "-";
+		out << std::setw(12) << r.involuntary_switches << std::setw(12) << r.migrations << "\n";
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+	// one object: the host, the config and a row per case; counters the host does not provide are null
+	inline void write_json(std::ostream& out, const config& c, const std::vector<result>& results)
+	{
+		using threading::perf_event;
+
+		auto per_access = [&](const result& r, const perf_event e) {
+			std::ostringstream s;
+			if (r.counters.has(e))
+				s << r.counters.per(e, r.accesses);
+			else
+				s << "null";
+			return s.str();
+		};
+
+		out << "{\n\"host\":{\"cpus\":" << c.cpus << "},\n";
+		out << "\"config\":{\"stride\":" << c.stride << ",\"duration_ms\":" << c.duration.count() << "},\n";
+		out << "\"results\":[";
+		for (std::size_t i = 0; i < results.size(); i++)
+		{
+			const result& r = results[i];
+			out << (i == 0 ? "\n" : ",\n") << "{\"threads\":" << r.threads << ",\"working_set\":" << r.working_set << ",\"pattern\":\"" << name(r.access)
+				<< "\",\"pinning\":\"" << name(r.placement) << "\",\"accesses\":" << r.accesses << ",\"seconds\":" << r.seconds
+				<< ",\"ns_per_access\":" << r.ns_per_access << ",\"gb_per_s\":" << r.gb_per_s << ",\"involuntary_switches\":" << r.involuntary_switches
+				<< ",\"migrations\":" << r.migrations << ",\"ipc\":";
+			if (r.counters.has(perf_event::cycles) && r.counters.has(perf_event::instructions))
+				out << r.counters.ipc();
+			else
+				out << "null";
+			out << ",\"cycles_per_access\":" << per_access(r, perf_event::cycles) << ",\"llc_misses_per_access\":" << per_access(r, perf_event::llc_misses)
+				<< ",\"cache_line_transfers_per_access\":" << per_access(r, perf_event::cache_line_transfers) << "}";
+		}
+		out << "\n]}\n";
+	}
+
+}
@@ -0,0 +1,90 @@
+#include "memory_bench.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	void print_usage(const char* exe)
+	{
+		std::cerr << "usage: " << exe << " [options]\n"
+				  << "  --threads 1,2,4          thread counts (default: powers of two up to the cpu count)\n"
+				  << "  --sizes 16K,256K,4M,32M  working set per thread (default: 16K,256K,4M,32M,256M)\n"
+				  << "  --patterns sequential,strided,random_chase\n"
+				  << "  --pinning none,compact,spread\n"
+				  << "  --stride 256             bytes between reads of the strided pattern\n"
+				  << "  --duration-ms 200        per case\n"
+				  << "  --cpus N                 cpus the pinning policies place threads on (default: all)\n"
+				  << "  --json out.json          results as JSON, - for stdout (the table then goes to stderr)\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	memory_bench::config c = memory_bench::config::defaults();
+	std::string			 json_path;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0 || i + 1 >= argc)
+		{
+			print_usage(argv[0]);
+			return std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0 ? 0 : 1;
+		}
+
+		const std::string value = argv[++i];
+		std::size_t		  number = 0;
+		bool			  ok = true;
+		if (std::strcmp(arg, "--threads") == 0)
+			ok = memory_bench::parse(value, c.threads);
+		else if (std::strcmp(arg, "--sizes") == 0)
+			ok = memory_bench::parse(value, c.working_sets);
+		else if (std::strcmp(arg, "--patterns") == 0)
+			ok = memory_bench::parse(value, c.patterns);
+		else if (std::strcmp(arg, "--pinning") == 0)
+			ok = memory_bench::parse(value, c.pinnings);
+		else if (std::strcmp(arg, "--stride") == 0)
+			ok = memory_bench::parse(value, c.stride) && c.stride > 0;
+		else if (std::strcmp(arg, "--duration-ms") == 0)
+		{
+			ok = memory_bench::parse(value, number) && number > 0;
+			c.duration = std::chrono::milliseconds(number);
+		}
+		else if (std::strcmp(arg, "--cpus") == 0)
+			ok = memory_bench::parse(value, c.cpus) && c.cpus > 0;
+		else if (std::strcmp(arg, "--json") == 0)
+			json_path = value;
+		else
+			ok = false;
+
+		if (ok == false || std::find(c.threads.begin(), c.threads.end(), std::size_t(0)) != c.threads.end())
+		{
+			std::cerr << "bad argument: " << arg << " " << value << "\n";
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::ostream& table = json_path == "-" ? std::cerr : std::cout;
+	memory_bench::write_table_header(table);
+	const std::vector<memory_bench::result> results = memory_bench::run(c, [&](const memory_bench::result& r) {
+		memory_bench::write_table_row(table, r);
+		table.flush();
+	});
+
+	if (json_path == "-")
+		memory_bench::write_json(std::cout, c, results);
+	else if (json_path.empty() == false)
+	{
+		std::ofstream out(json_path, std::ios::binary);
+		memory_bench::write_json(out, c, results);
+		if (!out)
+		{
+			std::cerr << "could not write " << json_path << "\n";
+			return 1;
+		}
+	}
+	return 0;
+}
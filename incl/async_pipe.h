@@ -1,27 +1,79 @@
 #pragma once
 
 #include "locked_wait.h"
+#include "pipe_storage.h"
+#include "unique_task.h"
+
+#include <chrono>
+#include <optional>
+
+#if defined(THREADING_COROUTINES)
+#	include "coro_task.h"
+#endif
 
 namespace threading
 {
 
+	enum class close_policy
+	{
+		drain, // consumers finish the remaining items before leaving
+		drop,  // remaining items are destroyed, consumers leave after their current item
+	};
+
+	// counters of an async_pipe, see async_pipe::stats()
+	struct async_pipe_stats
+	{
+		std::size_t depth = 0; // items waiting
+		std::size_t peak_depth = 0;
+		uint64_t	pushed = 0; // accepted by push_back(), hand-overs to async consumers included
+		uint64_t	consumed = 0; // taken by consumers, async ones included
+		uint64_t	rejected = 0; // pushed after close()
+		uint64_t	wakeups = 0; // sleeping consumers woken by push_back()
+		uint32_t	sleeping_consumers = 0;
+		uint32_t	polling_consumers = 0;
+		uint32_t	active_consumers = 0; // inside the consume function
+	};
+
 	// for multiple producers/multiple consumers of data T & multiple waiting threads
 	// low overhead when prodicing/consuming, consumers go to sleep when idle
-	template <class T>
+	// STORAGE decides the order items are consumed in, see pipe_storage.h
+	template <class T, class STORAGE = pipe_stack<T>>
 	struct async_pipe
 	{
 	public:
 		using consume_func_t = void(T&&);
+		using value_t = T;
+		using storage_t = STORAGE;
+
+		// spin budgets of consume_loop_or_spin()
+		static constexpr std::chrono::nanoseconds default_spin_budget = std::chrono::microseconds(50);
+		static constexpr std::chrono::nanoseconds spin_forever = std::chrono::nanoseconds::max();
+
+		// intrusive node for consumers that do not block a thread, see pop_async()
+		struct async_consumer : public threading::async_waiter
+		{
+			std::optional<T> item;
+		};
+
+	public:
+		async_pipe() = default;
+		template <class A0, class... A>
+		// arguments for the storage, like the starvation limit of priority_lanes
+		explicit async_pipe(A0&& storage_arg, A&&... storage_args)
+			: m_items(std::forward<A0>(storage_arg), std::forward<A>(storage_args)...)
+		{
+		}
 
 	public:
 		// for consumers:
 		// consume func type: void(T&&)/bool(T&&)
 
 		template <class F>
-		// returns only when evicted
+		// returns only when evicted or closed
 		void consume_loop_or_wait(const F& _func)
 		{
 			std::lock_guard<threading::spin_lock> _(m_first_lock);
+			m_attached_consumers++;
 			do
 			{
 				_consume_all_locked(_func);
@@ -29,60 +81,153 @@ namespace threading
 			_end_consumer(false);
 		}
 
+		template <class F>
+		// returns only when evicted or closed
+		// like consume_loop_or_wait(), but an idle consumer polls for spin_budget before it goes to sleep, producers do not wake
+		// consumers while one is polling; spin_forever never sleeps, for consumers with a core of their own (see utils::lock_current_thread_to_core)
+		void consume_loop_or_spin(const F& _func, const std::chrono::nanoseconds spin_budget = default_spin_budget)
+		{
+			std::lock_guard<threading::spin_lock> _(m_first_lock);
+			m_attached_consumers++;
+			do
+			{
+				do
+				{
+					_consume_all_locked(_func);
+				} while (_poll_locked(spin_budget));
+			} while (_wait_locked());
+			_end_consumer(false);
+		}
+
+		template <class F>
+		// like consume_loop_or_wait(), but also returns once it slept idle_timeout without getting an item
+		// returns true on the idle timeout, false when evicted or closed
+		bool consume_loop_or_wait_for(const F& _func, const std::chrono::nanoseconds idle_timeout)
+		{
+			std::lock_guard<threading::spin_lock> _(m_first_lock);
+			m_attached_consumers++;
+			bool idle = false;
+			do
+			{
+				_consume_all_locked(_func);
+			} while (_wait_for_locked(idle_timeout, idle));
+			return _end_consumer(false) && idle;
+		}
+
 		template <class F>
 		// void(T&&);
 		// try to get, immediately return when no items are available
-		// returns false when evicted
+		// returns false when evicted or closed
 		bool consume_loop(const F& _func, const bool wait_for_empty = false)
 		{
 			std::lock_guard<threading::spin_lock> _(m_first_lock);
+			m_attached_consumers++;
 			_consume_all_locked(_func);
 			return _end_consumer(wait_for_empty);
 		}
 		template <class F>
 		// bool(T&&)
 		// try to get, immediately return when no items are available
-		// returns false when evicted
+		// returns false when evicted or closed
 		bool consume_while(const F& _func, const bool wait_for_empty = false)
 		{
 			std::lock_guard<threading::spin_lock> _(m_first_lock);
+			m_attached_consumers++;
 			_consume_while_locked(_func);
 			return _end_consumer(wait_for_empty);
 		}
 
 	public:
-		// for producers; returns false if producers should stop
+		// for producers; returns false if producers should stop, items pushed to a closed pipe are discarded
+		// extra arguments go to the storage, like the lane for priority_lanes
 
-		bool push_back(T&& item)
+		template <class... A>
+		bool push_back(T&& item, A&&... storage_args)
 		{
-			std::lock_guard<threading::spin_lock> _(m_first_lock);
-			m_items.push_back(std::forward<T>(item));
-			return _notify_consumers();
+			m_first_lock.lock();
+			if (m_closed)
+				return _reject_closed();
+			if (m_async_consumers.empty() == false)
+				return _hand_over(std::move(item));
+			m_items.push(std::move(item), std::forward<A>(storage_args)...);
+			_count(m_stats.pushed);
+			_update_depth();
+			bool r = _notify_consumers();
+			m_first_lock.unlock();
+			return r;
 		}
-		bool push_back(const T& item)
+		template <class... A>
+		bool push_back(const T& item, A&&... storage_args)
+		{
+			m_first_lock.lock();
+			if (m_closed)
+				return _reject_closed();
+			if (m_async_consumers.empty() == false)
+				return _hand_over(T(item));
+			m_items.push(item, std::forward<A>(storage_args)...);
+			_count(m_stats.pushed);
+			_update_depth();
+			bool r = _notify_consumers();
+			m_first_lock.unlock();
+			return r;
+		}
+
+	public:
+		// for consumers that do not block a thread:
+		// returns true when c.item was filled immediately (empty when evicted or closed), otherwise c is queued
+		// and c.resume(&c) is called by the producer that hands it an item, or by evict()/close() with an empty item
+		// items handed to async consumers are not tracked by wait_for_empty()
+		bool pop_async(async_consumer& c)
 		{
 			std::lock_guard<threading::spin_lock> _(m_first_lock);
-			m_items.push_back(item);
-			return _notify_consumers();
+			if (_check_evict())
+			{
+				c.item.reset();
+				return true;
+			}
+			if (m_items.size() > 0)
+			{
+				c.item.emplace(m_items.pop());
+				_count(m_stats.consumed);
+				_update_depth();
+				return true;
+			}
+			if (m_closed)
+			{
+				c.item.reset();
+				return true;
+			}
+			m_async_consumers.push_back(c);
+			return false;
+		}
+
+#if defined(THREADING_COROUTINES)
+		// co_await pipe.pop(); returns std::optional<T>, empty when evicted
+		inline pipe_pop_awaiter<async_pipe<T, STORAGE>> pop()
+		{
+			return pipe_pop_awaiter<async_pipe<T, STORAGE>> { *this, {} };
 		}
+#endif
 
 		~async_pipe()
 		{
 			std::lock_guard<threading::spin_lock> _(m_first_lock);
 			THREADING_ASSERT(m_active_consumers == 0);
+			THREADING_ASSERT(m_attached_consumers == 0);
 			THREADING_ASSERT(m_evict_count == 0);
 			THREADING_ASSERT(m_sleeping_threads.awake_all(m_second_lock) == 0);
 			THREADING_ASSERT(m_waiting_threads.awake_all(m_second_lock) == 0);
+			THREADING_ASSERT(m_async_consumers.empty());
 		}
 	public: // others:
 
-		//return strue when evicting
+		//return strue when evicting or closed
 		bool wait_for_empty()
 		{
 			std::lock_guard<threading::spin_lock> _(m_first_lock);
-			if ((m_items.size() > 0 || m_active_consumers > 0))
+			if ((m_items.size() > 0 || m_active_consumers > 0) && m_closed == false)
 				m_waiting_threads.wait(m_first_lock, m_second_lock);
-			return _check_evict();
+			return _check_evict() || m_closed;
 		}
 		bool empty()
 		{
@@ -92,8 +237,39 @@ namespace threading
 			return false;
 		}
 
+		// items waiting, read without the lock so it may already be stale
+		inline std::size_t depth() const
+		{
+			return m_depth.load(std::memory_order_relaxed);
+		}
+
+		// reads counters kept in the existing critical sections, without the lock
+		// every field is current on its own, fields updated meanwhile do not have to agree with each other
+		async_pipe_stats stats() const
+		{
+			async_pipe_stats r;
+			r.depth = m_depth.load(std::memory_order_relaxed);
+			r.peak_depth = m_stats.peak_depth.load(std::memory_order_relaxed);
+			r.pushed = m_stats.pushed.load(std::memory_order_relaxed);
+			r.consumed = m_stats.consumed.load(std::memory_order_relaxed);
+			r.rejected = m_stats.rejected.load(std::memory_order_relaxed);
+			r.wakeups = m_stats.wakeups.load(std::memory_order_relaxed);
+			r.sleeping_consumers = m_stats.sleeping.load(std::memory_order_relaxed);
+			r.polling_consumers = m_stats.polling.load(std::memory_order_relaxed);
+			r.active_consumers = m_stats.active.load(std::memory_order_relaxed);
+			return r;
+		}
+
+		// only for members that are safe to use without the pipe lock, like priority_lanes::depth()
+		inline const STORAGE& storage() const
+		{
+			return m_items;
+		}
+
 	public:
-		void evict(const std::size_t evict_count, const uint32_t sleep_interval_ms)
+		// makes evict_count consumers leave, returns once they left or when no consumer is attached
+		// (consumers arriving later are evicted on arrival); sleep_interval_ms is unused, evicted consumers report back
+		void evict(const std::size_t evict_count, const uint32_t /*sleep_interval_ms*/ = 0)
 		{
 			THREADING_ASSERT(evict_count < std::numeric_limits<int_fast16_t>::max());
 			m_first_lock.lock();
@@ -101,63 +277,157 @@ namespace threading
 			THREADING_ASSERT(m_evict_count == 0);
 
 			m_evict_count = int_fast16_t(evict_count);
-			
-			while (true)
-			{
-				bool consumers = m_active_consumers > 0;
-				bool sleepers = m_sleeping_threads.awake_all(m_second_lock) > 0;
-				bool waiters = m_waiting_threads.awake_all(m_second_lock) > 0;
+			m_signal.fetch_add(1, std::memory_order_relaxed); // polling consumers come back to the lock
 
-				if ((consumers || sleepers || waiters) && m_evict_count > 0)
-				{
-					m_first_lock.unlock();
-					threading::utils::sleep_thread(sleep_interval_ms);
-					m_first_lock.lock();
-				}
-				else
-				{
-					break;
-				}
+			async_waiter* async_consumers = m_async_consumers.take_all();
+			if (async_consumers != nullptr)
+			{
+				m_first_lock.unlock();
+				_resume_evicted(async_consumers);
+				m_first_lock.lock();
 			}
 
+			m_sleeping_threads.awake_all(m_second_lock);
+			m_waiting_threads.awake_all(m_second_lock);
+
+			while (m_evict_count > 0 && m_attached_consumers > 0)
+				m_leaving_threads.wait(m_first_lock, m_second_lock);
+
 			m_first_lock.unlock();
 		}
 
+		// push_back() fails from now on, sleeping consumers are woken and leave once there is nothing left for them
+		// the pipe can not be reopened
+		void close(const close_policy policy = close_policy::drain)
+		{
+			async_waiter* async_consumers = nullptr;
+			{
+				std::lock_guard<threading::spin_lock> _(m_first_lock);
+				m_closed = true;
+				if (policy == close_policy::drop)
+					m_items.clear();
+				_update_depth();
+				m_signal.fetch_add(1, std::memory_order_relaxed);
+				async_consumers = m_async_consumers.take_all();
+				m_sleeping_threads.awake_all(m_second_lock);
+				m_waiting_threads.awake_all(m_second_lock);
+			}
+			_resume_evicted(async_consumers);
+		}
+
+		// blocks until the last consumer left the closed pipe
+		void wait_closed()
+		{
+			std::lock_guard<threading::spin_lock> _(m_first_lock);
+			THREADING_ASSERT(m_closed);
+			while (m_attached_consumers > 0)
+				m_leaving_threads.wait(m_first_lock, m_second_lock);
+		}
+
+		inline void close_and_wait(const close_policy policy = close_policy::drain)
+		{
+			close(policy);
+			wait_closed();
+		}
+
+		bool closed()
+		{
+			std::lock_guard<threading::spin_lock> _(m_first_lock);
+			return m_closed;
+		}
+
 	private:
+		inline bool _reject_closed()
+		{
+			_count(m_stats.rejected);
+			m_first_lock.unlock();
+			return false;
+		}
+		inline bool _hand_over(T&& item)
+		{
+			// called locked, unlocks; async consumers are only queued while m_items is empty
+			auto* c = static_cast<async_consumer*>(m_async_consumers.pop_front());
+			c->item.emplace(std::move(item));
+			_count(m_stats.pushed);
+			_count(m_stats.consumed);
+			m_first_lock.unlock();
+			c->resume(c);
+			return true;
+		}
+		inline static void _resume_evicted(async_waiter* head)
+		{
+			while (head != nullptr)
+			{
+				auto* c = static_cast<async_consumer*>(head);
+				head = head->next;
+				c->item.reset();
+				c->resume(c);
+			}
+		}
+
+		// called locked after every change of m_items
+		inline void _update_depth()
+		{
+			const std::size_t depth = m_items.size();
+			m_depth.store(depth, std::memory_order_relaxed);
+			if (depth > m_stats.peak_depth.load(std::memory_order_relaxed))
+				m_stats.peak_depth.store(depth, std::memory_order_relaxed);
+		}
+
+		// stats are only written under m_first_lock, no read-modify-write needed
+		template <class C>
+		inline static void _count(std::atomic<C>& counter, const int delta = 1)
+		{
+			counter.store(C(counter.load(std::memory_order_relaxed) + delta), std::memory_order_relaxed);
+		}
+
 		inline void _consume_one_begin()
 		{
-			m_items.pop_back();
+			_update_depth();
+			_count(m_stats.consumed);
 			m_active_consumers++;
+			m_stats.active.store(uint32_t(m_active_consumers), std::memory_order_relaxed);
 			m_first_lock.unlock();
 		}
 		inline void _consume_one_end()
 		{
 			m_first_lock.lock();
 			m_active_consumers--;
+			m_stats.active.store(uint32_t(m_active_consumers), std::memory_order_relaxed);
 		}
 		inline bool _check_evict() const
 		{
 			return m_evict_count > 0;
 		}
+		inline void _detach_consumer()
+		{
+			m_attached_consumers--;
+			// evict() and wait_closed() recheck on every consumer that leaves
+			if (m_evict_count > 0 || m_closed)
+				m_leaving_threads.awake_all(m_second_lock);
+		}
 		inline bool _end_consumer(const bool wait_for_empty)
 		{
 			bool no_evict = (m_evict_count <= 0);
+			_detach_consumer();
 			if (no_evict == false)
 			{
 				m_evict_count--;
+				// evicted consumers leave together, so a consumer that comes back is not evicted twice
+				// the last one to arrive releases the others one by one, they would only contend on m_first_lock
 				while (m_evict_count > 0)
-				{
-					m_first_lock.unlock();
-					std::this_thread::yield();
-					m_first_lock.lock();
-				}
+					m_evicted_threads.wait(m_first_lock, m_second_lock);
+				m_evicted_threads.awake_one(m_second_lock);
+				return false;
 			}
-			if (no_evict && wait_for_empty)
+			if (m_closed)
+				return false;
+			if (wait_for_empty)
 			{
 				if ((m_items.size() > 0 || m_active_consumers > 0))
 					m_waiting_threads.wait(m_first_lock, m_second_lock);
 			}
-			return no_evict;
+			return true;
 		}
 
 		template <class F>
@@ -165,9 +435,12 @@ namespace threading
 		{
 			while (m_items.size() > 0 && m_evict_count == 0)
 			{
-				T out = std::move(m_items.back());
+				T out = m_items.pop();
 				_consume_one_begin();
-				_func(std::move(out));
+				{
+					THREADING_TRACE_SCOPE("async_pipe consume");
+					_func(std::move(out));
+				}
 				_consume_one_end();
 
 				if (m_items.size() == 0 && m_active_consumers == 0)
@@ -182,9 +455,13 @@ namespace threading
 		{
 			while (m_items.size() > 0 && m_evict_count == 0)
 			{
-				T out = std::move(m_items.back());
+				T out = m_items.pop();
 				_consume_one_begin();
-				bool cond = _func(std::move(out));
+				bool cond;
+				{
+					THREADING_TRACE_SCOPE("async_pipe consume");
+					cond = _func(std::move(out));
+				}
 				_consume_one_end();
 
 				if (m_items.size() == 0 && m_active_consumers == 0)
@@ -199,30 +476,115 @@ namespace threading
 
 		inline bool _wait_locked()
 		{
-			if (_check_evict())
+			if (_check_evict() || m_closed)
 				return false;
+			THREADING_TRACE_SCOPE("async_pipe idle");
+			_count(m_stats.sleeping);
 			m_sleeping_threads.wait(m_first_lock, m_second_lock);
+			_count(m_stats.sleeping, -1);
 			return true;
 		}
+		inline bool _wait_for_locked(const std::chrono::nanoseconds idle_timeout, bool& idle)
+		{
+			if (_check_evict() || m_closed)
+				return false;
+			THREADING_TRACE_SCOPE("async_pipe idle");
+			_count(m_stats.sleeping);
+			const bool woken = m_sleeping_threads.wait_for(m_first_lock, m_second_lock, idle_timeout);
+			_count(m_stats.sleeping, -1);
+			if (woken)
+				return true;
+			idle = m_items.size() == 0; // an item that came with the timeout is still consumed
+			return idle == false;
+		}
+
+		// called locked, polls without the lock; returns true (locked again) when there are items to consume
+		inline bool _poll_locked(const std::chrono::nanoseconds spin_budget)
+		{
+			if (_check_evict() || m_closed || spin_budget.count() <= 0)
+				return false;
+
+			THREADING_TRACE_SCOPE("async_pipe poll");
+			m_polling_consumers++;
+			_count(m_stats.polling);
+			const uint32_t signal = m_signal.load(std::memory_order_relaxed);
+			m_first_lock.unlock();
+
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 1; m_depth.load(std::memory_order_relaxed) == 0; i++)
+			{
+				if (m_signal.load(std::memory_order_relaxed) != signal)
+					break;
+				threading_impl_spin_yield();
+				if ((i & 255) == 0 && spin_budget != spin_forever && std::chrono::steady_clock::now() - start >= spin_budget)
+					break;
+			}
+
+			m_first_lock.lock();
+			m_polling_consumers--;
+			_count(m_stats.polling, -1);
+			if (_check_evict())
+				return false;
+			// producers skipped the wakeup while we polled, so whatever arrived is ours; when another consumer took it
+			// a spin_forever consumer goes back to polling, it must not sleep on a wakeup nobody sends
+			return m_items.size() > 0 || (spin_budget == spin_forever && m_closed == false);
+		}
+
 		inline bool _notify_consumers()
 		{
 			if (_check_evict())
 				return false;
 
-			m_sleeping_threads.awake_one(m_second_lock);
+			// a polling consumer picks the item up without a wakeup
+			if (m_polling_consumers == 0 && m_sleeping_threads.awake_one(m_second_lock))
+				_count(m_stats.wakeups);
 			return true;
 		}
 
 	protected:
-		threading::spin_lock m_first_lock;
-		std::vector<T>		 m_items;
-		int_fast16_t		 m_evict_count = 0;
-		int_fast16_t		 m_active_consumers = 0;
+		// producers and consumers spin on the lock word, it gets a line of its own
+		THREADING_CACHE_ALIGNED threading::spin_lock m_first_lock;
+
+		// state guarded by m_first_lock, only touched by the lock holder
+		THREADING_CACHE_ALIGNED STORAGE m_items;
+		int_fast16_t				 m_evict_count = 0;
+		int_fast16_t				 m_active_consumers = 0;
+		int_fast16_t				 m_attached_consumers = 0; // inside one of the consume_* calls
+		int_fast16_t				 m_polling_consumers = 0; // consume_loop_or_spin() callers spinning outside the lock
+		bool						 m_closed = false;
+		threading::async_waiter_list m_async_consumers;
 
+		// written under m_first_lock, read by polling consumers without it
+		THREADING_CACHE_ALIGNED std::atomic<std::size_t> m_depth { 0 }; // m_items.size()
+		std::atomic<uint32_t> m_signal { 0 }; // bumped by evict() and close()
 
-		std::mutex	m_second_lock;
+		// written under m_first_lock, read by stats(); the counters share one line, only the lock holder writes them
+		struct THREADING_CACHE_ALIGNED stat_counters
+		{
+			std::atomic<std::size_t> peak_depth { 0 };
+			std::atomic<uint64_t>	 pushed { 0 };
+			std::atomic<uint64_t>	 consumed { 0 };
+			std::atomic<uint64_t>	 rejected { 0 };
+			std::atomic<uint64_t>	 wakeups { 0 };
+			std::atomic<uint32_t>	 sleeping { 0 };
+			std::atomic<uint32_t>	 polling { 0 };
+			std::atomic<uint32_t>	 active { 0 };
+		};
+		stat_counters m_stats;
+
+		// sleep/wake path, separate from the producer fast path
+		THREADING_CACHE_ALIGNED std::mutex m_second_lock;
 		locked_wait m_sleeping_threads;
 		locked_wait m_waiting_threads;
+		locked_wait m_leaving_threads; // evict() and wait_closed() wait here for consumers to leave
+		locked_wait m_evicted_threads; // evicted consumers wait here for the rest of the evicted group
 	};
 
+	template <class T, std::size_t LANES = 2>
+	// LANES priority levels drained highest first (lane 0) by the same consumers; push_back(item, lane)
+	using priority_async_pipe = async_pipe<T, priority_lanes<T, LANES>>;
+
+	// pipe of work items, consumers run them: p.consume_loop_or_wait([](unique_task&& t) { t(); })
+	using task_pipe = async_pipe<unique_task>;
+
 }
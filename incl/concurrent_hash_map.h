@@ -0,0 +1,464 @@
+#pragma once
+
+#include "lock_table.h"
+#include "object_pool.h"
+
+#include <functional>
+#include <type_traits>
+
+namespace threading
+{
+
+	template <class K, class V, class HASH = std::hash<K>, std::size_t STRIPES = 64>
+	// hash map with chained buckets, bucket i belongs to stripe i % STRIPES of a lock_table
+	// writers lock one stripe, so writes to keys on other stripes proceed in parallel
+	// the value of each stripe lock is a sequence number bumped by every write: when K and V are trivially copyable,
+	// find() reads without locking and retries if the sequence changed; otherwise it locks the stripe
+	// that unlocked copy races with writers on purpose (a seqlock read): a torn value is never returned, the sequence check
+	// throws it away, but it is a data race in the C++ model, so tsan builds lock instead
+	// nodes come from an object_pool and tables are only released with the map, so an optimistic reader never touches freed memory
+	// growing doubles the bucket count; the old table is migrated bucket by bucket by the writers (each writer first moves the
+	// bucket of its own key, then helps with a few others), a bucket and its two successors always share a stripe
+	struct concurrent_hash_map
+	{
+	public:
+		static_assert(STRIPES > 0 && (STRIPES & (STRIPES - 1)) == 0, "STRIPES must be a power of two");
+
+		using key_t = K;
+		using value_t = V;
+
+#if defined(__SANITIZE_THREAD__)
+		static constexpr bool optimistic_reads = false; // the validated racy copy is reported by tsan
+#else
+		static constexpr bool optimistic_reads = std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value;
+#endif
+		static constexpr std::size_t migrate_batch = 2; // old buckets moved by every write besides its own
+
+	public:
+		concurrent_hash_map(const concurrent_hash_map&) = delete;
+		concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+	public:
+		explicit concurrent_hash_map(const std::size_t bucket_count = STRIPES * 4)
+			: m_locks(0)
+		{
+			std::size_t n = STRIPES;
+			while (n < bucket_count)
+				n *= 2;
+			m_tables.emplace_back(new table(n));
+			m_table.store(m_tables.back().get(), std::memory_order_relaxed);
+			for (auto& c : m_counts)
+				c->store(0, std::memory_order_relaxed);
+		}
+		~concurrent_hash_map()
+		{
+			table* t = m_table.load(std::memory_order_relaxed);
+			_destroy_chains(t);
+			table* old = t->prev.load(std::memory_order_relaxed);
+			if (old != nullptr)
+				_destroy_chains(old);
+		}
+
+	public:
+		// returns true when the key was inserted, false when an existing value was replaced
+		template <class VV>
+		bool insert_or_assign(const K& key, VV&& value)
+		{
+			const std::size_t hash = _hash(key);
+			bool			  inserted = false;
+			bool			  grow = false;
+			{
+				write_guard w(*this, hash);
+				node*		n = _find_in(w.current, hash, key);
+				if (n != nullptr)
+				{
+					n->value = std::forward<VV>(value);
+				}
+				else
+				{
+					std::atomic<node*>& head = w.current->bucket(hash);
+					n = m_nodes.create(hash, key, std::forward<VV>(value));
+					n->next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+					head.store(n, std::memory_order_release);
+					inserted = true;
+
+					std::atomic<std::size_t>& count = *m_counts[_stripe(hash)];
+					std::size_t				  c = count.load(std::memory_order_relaxed) + 1;
+					count.store(c, std::memory_order_relaxed);
+					grow = c > (w.current->mask + 1) / STRIPES; // load factor 1 on this stripe
+				}
+			}
+			if (grow)
+				_grow();
+			_help_migrate();
+			return inserted;
+		}
+
+		// returns true when the key was found and removed
+		bool erase(const K& key)
+		{
+			const std::size_t hash = _hash(key);
+			node*			  removed = nullptr;
+			{
+				write_guard			w(*this, hash);
+				std::atomic<node*>* link = &w.current->bucket(hash);
+				for (node* n = link->load(std::memory_order_relaxed); n != nullptr; n = link->load(std::memory_order_relaxed))
+				{
+					if (n->hash == hash && n->key == key)
+					{
+						link->store(n->next.load(std::memory_order_relaxed), std::memory_order_release);
+						removed = n;
+						std::atomic<std::size_t>& count = *m_counts[_stripe(hash)];
+						count.store(count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+						break;
+					}
+					link = &n->next;
+				}
+				if (removed == nullptr)
+					w.changed = false;
+			}
+			// a concurrent optimistic reader may still look at the node, it fails validation once the memory is reused
+			if (removed != nullptr)
+				m_nodes.destroy(removed);
+			_help_migrate();
+			return removed != nullptr;
+		}
+
+		// copies the value into out
+		bool find(const K& key, V& out) const
+		{
+			const std::size_t hash = _hash(key);
+			if constexpr (optimistic_reads)
+			{
+				auto& l = m_locks.stripe_lock(_stripe(hash));
+				while (true)
+				{
+					const auto seq = l.data.load(std::memory_order_acquire);
+					if (l.value_locked(seq))
+					{
+						l.peek(); // spins, then parks until the writer is done
+						continue;
+					}
+
+					bool found = false;
+					if (_find_optimistic(l, seq, hash, key, out, found))
+						return found;
+				}
+			}
+			else
+			{
+				auto  g = m_locks.lock_stripe(_stripe(hash));
+				node* n = _find_in_any(hash, key);
+				if (n == nullptr)
+					return false;
+				out = n->value;
+				return true;
+			}
+		}
+
+		inline bool contains(const K& key) const
+		{
+			V tmp;
+			return find(key, tmp);
+		}
+
+		template <class F>
+		// void(V&) with the stripe of key locked; false when the key is not present
+		bool visit(const K& key, const F& _func)
+		{
+			const std::size_t hash = _hash(key);
+			write_guard		  w(*this, hash);
+			node*			  n = _find_in(w.current, hash, key);
+			if (n == nullptr)
+			{
+				w.changed = false;
+				return false;
+			}
+			_func(n->value);
+			return true;
+		}
+
+		template <class F>
+		// void(const K&, V&) for every entry, one stripe locked at a time; entries written meanwhile may or may not be seen
+		void for_each(const F& _func)
+		{
+			for (std::size_t s = 0; s < STRIPES; s++)
+			{
+				auto   g = m_locks.lock_stripe(s);
+				table* t = m_table.load(std::memory_order_acquire);
+				table* old = t->prev.load(std::memory_order_acquire);
+				if (old != nullptr)
+					_for_each_in(old, s, _func);
+				_for_each_in(t, s, _func);
+				g.value = _next_seq(g.value);
+			}
+		}
+
+		// not a snapshot
+		std::size_t size() const
+		{
+			std::size_t r = 0;
+			for (const auto& c : m_counts)
+				r += c->load(std::memory_order_relaxed);
+			return r;
+		}
+
+		std::size_t bucket_count() const
+		{
+			return m_table.load(std::memory_order_acquire)->mask + 1;
+		}
+
+	protected:
+		using lock_table_t = lock_table<STRIPES, uint32_t>;
+
+		struct node
+		{
+			template <class VV>
+			node(const std::size_t h, const K& k, VV&& v)
+				: hash(h)
+				, key(k)
+				, value(std::forward<VV>(v))
+			{
+			}
+
+			std::atomic<node*> next { nullptr };
+			const std::size_t  hash;
+			const K			   key;
+			V				   value;
+		};
+
+		struct table
+		{
+			explicit table(const std::size_t bucket_count)
+				: mask(bucket_count - 1)
+				, buckets(new std::atomic<node*>[bucket_count])
+			{
+				for (std::size_t i = 0; i < bucket_count; i++)
+					buckets[i].store(nullptr, std::memory_order_relaxed);
+			}
+
+			inline std::atomic<node*>& bucket(const std::size_t hash)
+			{
+				return buckets[hash & mask];
+			}
+
+			const std::size_t					  mask;
+			std::unique_ptr<std::atomic<node*>[]> buckets;
+
+			// set while the previous table is migrated into this one
+			std::atomic<table*>		 prev { nullptr };
+			std::atomic<std::size_t> migrate_next { 0 }; // next bucket of prev to claim
+			std::atomic<std::size_t> migrated { 0 }; // buckets of prev done
+		};
+
+		// head of an old bucket that was moved to the new table
+		inline static node* _moved()
+		{
+			return reinterpret_cast<node*>(uintptr_t(1));
+		}
+
+		// locks the stripe of hash, moves the old bucket of hash if a migration runs, bumps the sequence on release
+		struct write_guard
+		{
+			write_guard(concurrent_hash_map& map, const std::size_t hash)
+				: lock(map.m_locks.lock_stripe(map._stripe(hash)))
+				, current(map.m_table.load(std::memory_order_acquire))
+			{
+				// the locked state is visible before any of the writes below, a reader that copies them fails the sequence check
+				std::atomic_thread_fence(std::memory_order_release);
+				table* old = current->prev.load(std::memory_order_acquire);
+				if (old != nullptr && map._migrate_locked(old, current, hash & old->mask))
+					changed = true;
+			}
+			~write_guard()
+			{
+				if (changed)
+					lock.value = _next_seq(lock.value);
+			}
+
+			typename lock_table_t::guard lock;
+			table*						 current;
+			bool						 changed = true;
+		};
+
+	protected:
+		inline static std::size_t _hash(const K& key)
+		{
+			uint64_t h = uint64_t(HASH {}(key)) * 0x9E3779B97F4A7C15ull;
+			return std::size_t(h ^ (h >> 29));
+		}
+		inline static std::size_t _stripe(const std::size_t hash)
+		{
+			return hash & (STRIPES - 1);
+		}
+		inline static uint32_t _next_seq(const uint32_t seq)
+		{
+			return seq + 1 < lock_table_t::lock_t::parked_state ? seq + 1 : 0; // skips the lock states
+		}
+
+		inline static node* _find_chain(node* n, const std::size_t hash, const K& key)
+		{
+			for (; n != nullptr; n = n->next.load(std::memory_order_relaxed))
+			{
+				if (n->hash == hash && n->key == key)
+					return n;
+			}
+			return nullptr;
+		}
+
+		// stripe locked and own bucket migrated
+		inline node* _find_in(table* t, const std::size_t hash, const K& key)
+		{
+			return _find_chain(t->bucket(hash).load(std::memory_order_relaxed), hash, key);
+		}
+
+		// stripe locked, the old bucket may not be migrated yet
+		inline node* _find_in_any(const std::size_t hash, const K& key) const
+		{
+			table* t = m_table.load(std::memory_order_acquire);
+			table* old = t->prev.load(std::memory_order_acquire);
+			if (old != nullptr)
+			{
+				node* head = old->bucket(hash).load(std::memory_order_relaxed);
+				if (head != _moved())
+					return _find_chain(head, hash, key);
+			}
+			return _find_chain(t->bucket(hash).load(std::memory_order_relaxed), hash, key);
+		}
+
+		// false when the sequence changed and the lookup has to be repeated
+		template <class L>
+		bool _find_optimistic(const L& l, const uint32_t seq, const std::size_t hash, const K& key, V& out, bool& found) const
+		{
+			table* t = m_table.load(std::memory_order_acquire);
+			table* old = t->prev.load(std::memory_order_acquire);
+			node*  n = nullptr;
+			if (old != nullptr)
+				n = old->bucket(hash).load(std::memory_order_acquire);
+			if (old == nullptr || n == _moved())
+				n = t->bucket(hash).load(std::memory_order_acquire);
+
+			uint32_t steps = 0;
+			while (n != nullptr && n != _moved())
+			{
+				if (n->hash == hash && n->key == key)
+				{
+					out = n->value;
+					found = true;
+					break;
+				}
+				n = n->next.load(std::memory_order_acquire);
+
+				// a node recycled under us can lead into another chain, check now and then that this is not the case
+				if ((++steps & 63) == 0 && l.data.load(std::memory_order_relaxed) != seq)
+					return false;
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return l.data.load(std::memory_order_relaxed) == seq;
+		}
+
+		template <class F>
+		inline void _for_each_in(table* t, const std::size_t stripe, const F& _func)
+		{
+			for (std::size_t b = stripe; b <= t->mask; b += STRIPES)
+			{
+				node* n = t->buckets[b].load(std::memory_order_relaxed);
+				if (n == _moved())
+					continue;
+				for (; n != nullptr; n = n->next.load(std::memory_order_relaxed))
+					_func(n->key, n->value);
+			}
+		}
+
+		// stripe of index locked; returns true when the bucket was moved by this call
+		bool _migrate_locked(table* old, table* current, const std::size_t index)
+		{
+			std::atomic<node*>& src = old->buckets[index];
+			node*				n = src.load(std::memory_order_relaxed);
+			if (n == _moved())
+				return false;
+			while (n != nullptr)
+			{
+				node*				next = n->next.load(std::memory_order_relaxed);
+				std::atomic<node*>& dst = current->bucket(n->hash);
+				n->next.store(dst.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				dst.store(n, std::memory_order_release);
+				n = next;
+			}
+			src.store(_moved(), std::memory_order_release);
+			return true;
+		}
+
+		void _help_migrate()
+		{
+			table* t = m_table.load(std::memory_order_acquire);
+			table* old = t->prev.load(std::memory_order_acquire);
+			if (old == nullptr)
+				return;
+
+			for (std::size_t i = 0; i < migrate_batch; i++)
+			{
+				const std::size_t index = t->migrate_next.fetch_add(1, std::memory_order_relaxed);
+				if (index > old->mask)
+					return;
+				{
+					auto g = m_locks.lock_stripe(index & (STRIPES - 1));
+					if (_migrate_locked(old, t, index))
+						g.value = _next_seq(g.value);
+				}
+				if (t->migrated.fetch_add(1, std::memory_order_acq_rel) == old->mask)
+				{
+					// every bucket moved; old stays allocated for readers that still look at it
+					t->prev.store(nullptr, std::memory_order_release);
+					return;
+				}
+			}
+		}
+
+		void _grow()
+		{
+			std::unique_lock<std::mutex> lk(m_grow_lock, std::try_to_lock);
+			if (lk.owns_lock() == false)
+				return;
+
+			table* t = m_table.load(std::memory_order_acquire);
+			if (t->prev.load(std::memory_order_acquire) != nullptr)
+				return; // still migrating
+			if (size() <= t->mask + 1)
+				return;
+
+			m_tables.emplace_back(new table((t->mask + 1) * 2));
+			table* grown = m_tables.back().get();
+			grown->prev.store(t, std::memory_order_relaxed);
+			m_table.store(grown, std::memory_order_release);
+		}
+
+		void _destroy_chains(table* t)
+		{
+			for (std::size_t b = 0; b <= t->mask; b++)
+			{
+				node* n = t->buckets[b].load(std::memory_order_relaxed);
+				if (n == _moved())
+					continue;
+				while (n != nullptr)
+				{
+					node* next = n->next.load(std::memory_order_relaxed);
+					m_nodes.destroy(n);
+					n = next;
+				}
+			}
+		}
+
+	protected:
+		mutable lock_table_t								   m_locks; // stripe values are the sequence numbers
+		std::array<cache_padded<std::atomic<std::size_t>>, STRIPES> m_counts; // entries per stripe, written under the stripe lock
+		std::atomic<table*>									   m_table { nullptr };
+
+		std::mutex						   m_grow_lock;
+		std::vector<std::unique_ptr<table>> m_tables; // all tables ever used, guarded by m_grow_lock
+
+		object_pool<node> m_nodes;
+	};
+
+}
@@ -0,0 +1,374 @@
+#pragma once
+
+#include "worker_pool.h"
+
+#if defined(THREADING_COROUTINES)
+
+#	include <coroutine>
+#	include <optional>
+
+namespace threading
+{
+
+	template <class T = void>
+	struct task;
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class Base = async_waiter>
+	// async_waiter that resumes a suspended coroutine
+	// a coroutine suspended on a worker_pool thread is resumed on that pool, otherwise it is resumed inline by the notifying thread
+	struct coroutine_waiter : public Base
+	{
+	public:
+		inline void prepare(std::coroutine_handle<> h)
+		{
+			m_handle = h;
+			m_pool = worker_pool::current();
+			this->resume = &coroutine_waiter::_resume;
+		}
+
+	protected:
+		static void _resume(async_waiter* w)
+		{
+			auto*				   self = static_cast<coroutine_waiter*>(w);
+			std::coroutine_handle<> h = self->m_handle;
+			worker_pool*			pool = self->m_pool;
+			if (pool != nullptr)
+				pool->submit_local([h]() { h.resume(); });
+			else
+				h.resume();
+		}
+
+	protected:
+		std::coroutine_handle<> m_handle;
+		worker_pool*			m_pool = nullptr;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	namespace detail
+	{
+		struct task_promise_base
+		{
+			struct final_awaiter
+			{
+				inline bool await_ready() noexcept
+				{
+					return false;
+				}
+				template <class P>
+				inline std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+				{
+					return h.promise().continuation;
+				}
+				inline void await_resume() noexcept
+				{
+				}
+			};
+
+			inline std::suspend_always initial_suspend() noexcept
+			{
+				return {};
+			}
+			inline final_awaiter final_suspend() noexcept
+			{
+				return {};
+			}
+			inline void unhandled_exception()
+			{
+				std::terminate();
+			}
+
+			std::coroutine_handle<> continuation = std::noop_coroutine();
+		};
+
+		template <class T>
+		struct task_promise : public task_promise_base
+		{
+			task<T> get_return_object() noexcept;
+
+			template <class V>
+			inline void return_value(V&& v)
+			{
+				value.emplace(std::forward<V>(v));
+			}
+
+			std::optional<T> value;
+		};
+
+		template <>
+		struct task_promise<void> : public task_promise_base
+		{
+			task<void> get_return_object() noexcept;
+
+			inline void return_void() noexcept
+			{
+			}
+		};
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T>
+	// lazily started coroutine, runs when awaited and resumes the awaiting coroutine when done
+	struct task
+	{
+	public:
+		using promise_type = detail::task_promise<T>;
+		using handle_t = std::coroutine_handle<promise_type>;
+
+	public:
+		task(const task&) = delete;
+		task& operator=(const task&) = delete;
+
+	public:
+		task() = default;
+		explicit task(handle_t h)
+			: m_handle(h)
+		{
+		}
+		task(task&& other) noexcept
+			: m_handle(other.m_handle)
+		{
+			other.m_handle = nullptr;
+		}
+		task& operator=(task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (m_handle)
+					m_handle.destroy();
+				m_handle = other.m_handle;
+				other.m_handle = nullptr;
+			}
+			return *this;
+		}
+		~task()
+		{
+			if (m_handle)
+				m_handle.destroy();
+		}
+
+	public:
+		struct awaiter
+		{
+			handle_t handle;
+
+			inline bool await_ready() const noexcept
+			{
+				THREADING_ASSERT(handle); // awaiting an empty (moved from) task
+				return handle.done();
+			}
+			inline std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+			{
+				handle.promise().continuation = awaiting;
+				return handle;
+			}
+			inline T await_resume()
+			{
+				if constexpr (std::is_void<T>::value == false)
+					return std::move(*handle.promise().value);
+			}
+		};
+
+		inline awaiter operator co_await() const& noexcept
+		{
+			return awaiter { m_handle };
+		}
+
+		inline bool valid() const
+		{
+			return bool(m_handle);
+		}
+
+	protected:
+		handle_t m_handle = nullptr;
+	};
+
+	namespace detail
+	{
+		template <class T>
+		inline task<T> task_promise<T>::get_return_object() noexcept
+		{
+			return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+		}
+		inline task<void> task_promise<void>::get_return_object() noexcept
+		{
+			return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+		}
+
+		// coroutine started eagerly and destroyed at completion, used by spawn() and sync_wait()
+		struct detached_task
+		{
+			struct promise_type
+			{
+				inline detached_task get_return_object() noexcept
+				{
+					return {};
+				}
+				inline std::suspend_never initial_suspend() noexcept
+				{
+					return {};
+				}
+				inline std::suspend_never final_suspend() noexcept
+				{
+					return {};
+				}
+				inline void return_void() noexcept
+				{
+				}
+				inline void unhandled_exception()
+				{
+					std::terminate();
+				}
+			};
+		};
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	struct schedule_awaiter
+	{
+		worker_pool& pool;
+
+		inline bool await_ready() const noexcept
+		{
+			return false;
+		}
+		inline void await_suspend(std::coroutine_handle<> h)
+		{
+			pool.submit_local([h]() { h.resume(); });
+		}
+		inline void await_resume() const noexcept
+		{
+		}
+	};
+
+	// co_await schedule_on(pool); continues the coroutine on a worker of pool
+	inline schedule_awaiter schedule_on(worker_pool& pool)
+	{
+		return schedule_awaiter { pool };
+	}
+
+	namespace detail
+	{
+		inline detached_task spawn_body(worker_pool& pool, task<void> t)
+		{
+			co_await schedule_on(pool);
+			co_await t;
+		}
+
+		template <class T>
+		inline detached_task sync_wait_body(task<T>& t, std::optional<T>& out, join_counter& done)
+		{
+			out.emplace(co_await t);
+			done.done();
+		}
+		inline detached_task sync_wait_body(task<void>& t, join_counter& done)
+		{
+			co_await t;
+			done.done();
+		}
+	}
+
+	// runs t on pool without waiting for it
+	inline void spawn(worker_pool& pool, task<void>&& t)
+	{
+		detail::spawn_body(pool, std::move(t));
+	}
+
+	template <class T>
+	// blocks the calling thread until t completes, do not call from a worker of the pool t is waiting on
+	inline T sync_wait(task<T>&& t)
+	{
+		join_counter	 done(1);
+		std::optional<T> out;
+		detail::sync_wait_body(t, out, done);
+		done.wait();
+		return std::move(*out);
+	}
+	inline void sync_wait(task<void>&& t)
+	{
+		join_counter done(1);
+		detail::sync_wait_body(t, done);
+		done.wait();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	struct latch_awaiter
+	{
+		latch&			   l;
+		coroutine_waiter<> node;
+
+		inline bool await_ready() const noexcept
+		{
+			return false;
+		}
+		inline bool await_suspend(std::coroutine_handle<> h)
+		{
+			node.prepare(h);
+			return l.arrive_async(node) == false;
+		}
+		inline void await_resume() const noexcept
+		{
+		}
+	};
+
+	// co_await l; arrives at the latch and suspends until the group is complete
+	inline latch_awaiter operator co_await(latch& l)
+	{
+		return latch_awaiter { l, {} };
+	}
+
+	struct semaphore_awaiter
+	{
+		semaphore&		   sem;
+		coroutine_waiter<> node;
+
+		inline bool await_ready() const noexcept
+		{
+			return false;
+		}
+		inline bool await_suspend(std::coroutine_handle<> h)
+		{
+			node.prepare(h);
+			return sem.acquire_async(node) == false;
+		}
+		inline void await_resume() const noexcept
+		{
+		}
+	};
+
+	// co_await acquire(sem); suspends until a count is available, release with sem.release()
+	inline semaphore_awaiter acquire(semaphore& sem)
+	{
+		return semaphore_awaiter { sem, {} };
+	}
+
+	template <class P>
+	// returned by async_pipe<T>::pop(), resumes with the item or std::nullopt when the pipe is evicted
+	struct pipe_pop_awaiter
+	{
+		P&												  pipe;
+		coroutine_waiter<typename P::async_consumer> node;
+
+		inline bool await_ready() const noexcept
+		{
+			return false;
+		}
+		inline bool await_suspend(std::coroutine_handle<> h)
+		{
+			node.prepare(h);
+			return pipe.pop_async(node) == false;
+		}
+		inline std::optional<typename P::value_t> await_resume()
+		{
+			return std::move(node.item);
+		}
+	};
+
+}
+
+#endif
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "async_pipe.h"
+
+#include <functional>
+
+namespace threading
+{
+
+	template <class PIPE>
+	// consumer threads of an async_pipe that follow the load, between min_threads and max_threads
+	// a consumer that sees more than grow_depth items waiting starts one more thread (one start at a time)
+	// a consumer that slept idle_timeout without work retires while more than min_threads run
+	// the destructor evicts the remaining consumers, the pipe stays usable; other blocking consumers of the same pipe would
+	// take part in that eviction, so the pool should be the only one
+	struct elastic_consumers
+	{
+	public:
+		using value_t = typename PIPE::value_t;
+		using consume_t = std::function<void(value_t&&)>;
+
+	public:
+		elastic_consumers(const elastic_consumers&) = delete;
+		elastic_consumers& operator=(const elastic_consumers&) = delete;
+
+	public:
+		elastic_consumers(PIPE&							pipe,
+						  const std::size_t				min_threads,
+						  const std::size_t				max_threads,
+						  const std::size_t				grow_depth,
+						  const std::chrono::nanoseconds idle_timeout,
+						  consume_t&&					_func)
+			: m_pipe(pipe)
+			, m_min_threads(min_threads)
+			, m_max_threads(max_threads)
+			, m_grow_depth(grow_depth)
+			, m_idle_timeout(idle_timeout)
+			, m_func(std::move(_func))
+		{
+			THREADING_ASSERT(min_threads > 0); // growing is done by running consumers
+			THREADING_ASSERT(min_threads <= max_threads);
+
+			std::lock_guard<std::mutex> _(m_lock);
+			for (std::size_t i = 0; i < min_threads; i++)
+				_spawn_locked();
+		}
+
+		// the pipe must not be closed concurrently
+		~elastic_consumers()
+		{
+			std::size_t running;
+			{
+				std::lock_guard<std::mutex> _(m_lock);
+				m_stopping = true;
+				running = m_running;
+			}
+			// every counted thread is in the pipe or about to enter it, only eviction lets it leave now
+			if (running > 0 && m_pipe.closed() == false)
+				m_pipe.evict(running);
+
+			// evicted consumers take m_lock on their way out, join without it
+			std::vector<std::thread> threads;
+			{
+				std::lock_guard<std::mutex> _(m_lock);
+				threads.swap(m_threads);
+			}
+			for (auto& t : threads)
+				t.join();
+		}
+
+	public:
+		// threads started and not retired
+		inline std::size_t size() const
+		{
+			return m_running_hint.load(std::memory_order_relaxed);
+		}
+
+		// most threads running at once so far
+		inline std::size_t peak_size() const
+		{
+			return m_peak.load(std::memory_order_relaxed);
+		}
+
+	protected:
+		void _run()
+		{
+			{
+				std::lock_guard<std::mutex> _(m_lock);
+				m_starting = false;
+			}
+
+			const auto consume = [this](value_t&& item) {
+				if (m_pipe.depth() > m_grow_depth)
+					_grow();
+				m_func(std::move(item));
+			};
+
+			while (true)
+			{
+				const bool idle = m_pipe.consume_loop_or_wait_for(consume, m_idle_timeout);
+
+				// the retire check and the decrement share one critical section, so the destructor's count stays exact
+				// and two consumers timing out together cannot both retire the pool below m_min_threads
+				std::lock_guard<std::mutex> _(m_lock);
+				if (idle && (m_stopping || m_running <= m_min_threads))
+					continue;
+				// retired, evicted or closed
+				m_running--;
+				m_running_hint.store(m_running, std::memory_order_relaxed);
+				m_exited.push_back(std::this_thread::get_id());
+				return;
+			}
+		}
+
+		void _grow()
+		{
+			if (m_running_hint.load(std::memory_order_relaxed) >= m_max_threads)
+				return;
+			std::lock_guard<std::mutex> _(m_lock);
+			if (m_stopping || m_starting || m_running >= m_max_threads)
+				return;
+			_spawn_locked();
+		}
+
+		void _spawn_locked()
+		{
+			_reap_locked();
+			m_running++;
+			m_running_hint.store(m_running, std::memory_order_relaxed);
+			if (m_running > m_peak.load(std::memory_order_relaxed))
+				m_peak.store(m_running, std::memory_order_relaxed);
+			m_starting = true;
+			m_threads.emplace_back();
+			threading::utils::start_native(m_threads.back(), [this]() { _run(); });
+		}
+
+		// joins threads that retired, they hold no lock on their way out
+		void _reap_locked()
+		{
+			for (const std::thread::id id : m_exited)
+			{
+				for (std::size_t i = 0; i < m_threads.size(); i++)
+				{
+					if (m_threads[i].get_id() != id)
+						continue;
+					m_threads[i].join();
+					m_threads[i] = std::move(m_threads.back());
+					m_threads.pop_back();
+					break;
+				}
+			}
+			m_exited.clear();
+		}
+
+	protected:
+		PIPE&							m_pipe;
+		const std::size_t				m_min_threads;
+		const std::size_t				m_max_threads;
+		const std::size_t				m_grow_depth;
+		const std::chrono::nanoseconds m_idle_timeout;
+		const consume_t					m_func;
+
+		std::mutex					 m_lock;
+		std::vector<std::thread>	 m_threads;
+		std::vector<std::thread::id> m_exited; // returned from _run(), not joined yet
+		std::size_t					 m_running = 0;
+		bool						 m_starting = false; // a new thread has not reached _run() yet
+		bool						 m_stopping = false;
+
+		std::atomic<std::size_t> m_running_hint { 0 };
+		std::atomic<std::size_t> m_peak { 0 };
+	};
+
+}
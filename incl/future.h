@@ -0,0 +1,503 @@
+#pragma once
+
+#include "unique_task.h"
+#include "worker_pool.h"
+
+#include <exception>
+#include <optional>
+#include <type_traits>
+
+namespace threading
+{
+
+	template <class T>
+	struct future;
+	template <class T>
+	struct promise;
+
+	namespace detail
+	{
+		struct future_void
+		{
+		};
+
+		template <class T>
+		using future_stored_t = typename std::conditional<std::is_void<T>::value, future_void, T>::type;
+
+		template <class T>
+		// shared state of one promise/future pair
+		// state machine: empty -> value (set_value first) or empty -> continuation (then first), the second transition runs the continuation
+		// a broken promise completes the state without a value
+		struct future_state
+		{
+		public:
+			using stored_t = future_stored_t<T>;
+
+			enum : uint32_t
+			{
+				state_empty = 0,
+				state_value = 1,
+				state_continuation = 2,
+			};
+
+			static_assert(alignof(stored_t) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned values are not supported");
+
+		public:
+			inline static future_state* create()
+			{
+				return new (block_pool<sizeof(future_state)>::alloc()) future_state();
+			}
+
+			inline void release()
+			{
+				if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					this->~future_state();
+					block_pool<sizeof(future_state)>::free(this);
+				}
+			}
+			inline void add_ref()
+			{
+				m_refs.fetch_add(1, std::memory_order_relaxed);
+			}
+
+		public:
+			template <class... Args>
+			inline void set_value(Args&&... args)
+			{
+				m_value.emplace(std::forward<Args>(args)...);
+				_complete();
+			}
+
+			// the promise went away without a value, waiters wake up and continuations run
+			inline void set_broken()
+			{
+				m_broken = true;
+				_complete();
+			}
+
+			template <class F>
+			// void(); called once the value is set, inline when it already is
+			inline void set_continuation(F&& _func)
+			{
+				m_continuation = std::forward<F>(_func);
+				uint32_t expected = state_empty;
+				if (m_state.compare_exchange_strong(expected, state_continuation, std::memory_order_acq_rel) == false)
+					_run_continuation();
+			}
+
+			inline bool ready() const
+			{
+				return m_state.load(std::memory_order_acquire) == state_value;
+			}
+			// only meaningful once ready
+			inline bool broken() const
+			{
+				return m_broken;
+			}
+
+			inline stored_t take()
+			{
+				THREADING_ASSERT(m_value.has_value());
+				return std::move(*m_value);
+			}
+
+		protected:
+			inline void _complete()
+			{
+				if (m_state.exchange(state_value, std::memory_order_acq_rel) == state_continuation)
+					_run_continuation();
+			}
+
+			inline void _run_continuation()
+			{
+				unique_task c = std::move(m_continuation);
+				c();
+			}
+
+		protected:
+			std::atomic<uint32_t>	m_state { state_empty };
+			std::atomic<uint32_t>	m_refs { 2 };
+			std::optional<stored_t> m_value;
+			bool					m_broken = false;
+			unique_task				m_continuation;
+		};
+
+		template <class F, class T>
+		struct future_then_result
+		{
+			using type = typename std::invoke_result<F, T>::type;
+		};
+		template <class F>
+		struct future_then_result<F, void>
+		{
+			using type = typename std::invoke_result<F>::type;
+		};
+
+		template <class R, class T, class F>
+		// runs _func with the value of src and fulfills dst, a broken src breaks dst without calling _func
+		inline void future_invoke(future_state<R>* dst, future_state<T>* src, F& _func)
+		{
+			if (src->broken())
+			{
+				dst->set_broken();
+				return;
+			}
+			if constexpr (std::is_void<T>::value)
+			{
+				src->take();
+				if constexpr (std::is_void<R>::value)
+				{
+					_func();
+					dst->set_value();
+				}
+				else
+				{
+					dst->set_value(_func());
+				}
+			}
+			else
+			{
+				if constexpr (std::is_void<R>::value)
+				{
+					_func(src->take());
+					dst->set_value();
+				}
+				else
+				{
+					dst->set_value(_func(src->take()));
+				}
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T>
+	// single consumer future, the shared state comes from a block_pool and is never locked
+	// when the promise is destroyed without a value the future completes as broken(), continuations are skipped and their futures
+	// break too
+	struct future
+	{
+	public:
+		using state_t = detail::future_state<T>;
+
+	public:
+		future(const future&) = delete;
+		future& operator=(const future&) = delete;
+
+	public:
+		future() = default;
+		future(future&& other) noexcept
+			: m_state(other.m_state)
+		{
+			other.m_state = nullptr;
+		}
+		future& operator=(future&& other) noexcept
+		{
+			if (this != &other)
+			{
+				_release();
+				m_state = other.m_state;
+				other.m_state = nullptr;
+			}
+			return *this;
+		}
+		~future()
+		{
+			_release();
+		}
+
+	public:
+		inline bool valid() const
+		{
+			return m_state != nullptr;
+		}
+		inline bool ready() const
+		{
+			THREADING_ASSERT(valid());
+			return m_state->ready();
+		}
+		// completed without a value, the promise was destroyed first
+		inline bool broken() const
+		{
+			THREADING_ASSERT(valid());
+			return m_state->ready() && m_state->broken();
+		}
+
+		// blocks until the value is set
+		void wait()
+		{
+			THREADING_ASSERT(valid());
+			if (m_state->ready())
+				return;
+			join_counter done(1);
+			m_state->set_continuation([&done]() { done.done(); });
+			done.wait();
+		}
+
+		// blocks until the value is set, consumes the future
+		// there is no value to return from a broken promise, that terminates like an uncaught std::future_error would
+		T get()
+		{
+			wait();
+			state_t* s = m_state;
+			m_state = nullptr;
+			if (s->broken())
+			{
+				THREADING_ASSERT_FALSE("broken promise");
+				std::terminate();
+			}
+			if constexpr (std::is_void<T>::value)
+			{
+				s->release();
+			}
+			else
+			{
+				T r = s->take();
+				s->release();
+				return r;
+			}
+		}
+
+		template <class F>
+		// R(T) or R() for future<void>; runs inline on the thread that sets the value (or on this thread if already set)
+		auto then(F&& _func) -> future<typename detail::future_then_result<F, T>::type>
+		{
+			using R = typename detail::future_then_result<F, T>::type;
+			THREADING_ASSERT(valid());
+
+			future<R> r;
+			auto*	  dst = detail::future_state<R>::create();
+			r.m_state = dst;
+
+			state_t* src = m_state;
+			m_state = nullptr;
+			src->set_continuation([dst, src, f = std::forward<F>(_func)]() mutable {
+				detail::future_invoke(dst, src, f);
+				dst->release();
+				src->release();
+			});
+			return r;
+		}
+
+		template <class F>
+		// same as then(_func) but _func is scheduled onto pool once the value is set
+		auto then(worker_pool& pool, F&& _func) -> future<typename detail::future_then_result<F, T>::type>
+		{
+			using R = typename detail::future_then_result<F, T>::type;
+			THREADING_ASSERT(valid());
+
+			future<R> r;
+			auto*	  dst = detail::future_state<R>::create();
+			r.m_state = dst;
+
+			state_t* src = m_state;
+			m_state = nullptr;
+			src->set_continuation([&pool, dst, src, f = std::forward<F>(_func)]() mutable {
+				pool.submit_local([dst, src, f = std::move(f)]() mutable {
+					detail::future_invoke(dst, src, f);
+					dst->release();
+					src->release();
+				});
+			});
+			return r;
+		}
+
+	protected:
+		template <class U>
+		friend struct future;
+		template <class U>
+		friend struct promise;
+
+		inline void _release()
+		{
+			if (m_state != nullptr)
+			{
+				m_state->release();
+				m_state = nullptr;
+			}
+		}
+
+	protected:
+		state_t* m_state = nullptr;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T>
+	struct promise
+	{
+	public:
+		using state_t = detail::future_state<T>;
+
+	public:
+		promise(const promise&) = delete;
+		promise& operator=(const promise&) = delete;
+
+	public:
+		promise()
+			: m_state(state_t::create())
+		{
+		}
+		promise(promise&& other) noexcept
+			: m_state(other.m_state)
+			, m_future_taken(other.m_future_taken)
+		{
+			other.m_state = nullptr;
+		}
+		~promise()
+		{
+			if (m_state == nullptr)
+				return;
+			if (m_future_taken)
+				m_state->set_broken(); // the future keeps its reference
+			else
+				m_state->release();
+			m_state->release();
+		}
+
+	public:
+		future<T> get_future()
+		{
+			THREADING_ASSERT(m_future_taken == false);
+			m_future_taken = true;
+			future<T> r;
+			r.m_state = m_state;
+			return r;
+		}
+
+		template <class... Args>
+		void set_value(Args&&... args)
+		{
+			THREADING_ASSERT(m_state != nullptr);
+			state_t* s = m_state;
+			m_state = nullptr;
+			if (m_future_taken == false)
+				s->release(); // nobody will read the value
+			s->set_value(std::forward<Args>(args)...);
+			s->release();
+		}
+
+	protected:
+		state_t* m_state;
+		bool	 m_future_taken = false;
+	};
+
+	template <class T, class... Args>
+	inline future<T> make_ready_future(Args&&... args)
+	{
+		promise<T> p;
+		future<T>  r = p.get_future();
+		p.set_value(std::forward<Args>(args)...);
+		return r;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T>
+	// like a latch with one waiter: completes when all futures are set, values are kept in input order
+	future<std::vector<T>> when_all(std::vector<future<T>>&& futures)
+	{
+		struct context
+		{
+			std::atomic<std::size_t>	  remaining;
+			std::vector<std::optional<T>> values;
+			promise<std::vector<T>>		  done;
+		};
+		if (futures.empty())
+			return make_ready_future<std::vector<T>>();
+
+		auto ctx = std::make_shared<context>();
+		ctx->remaining.store(futures.size(), std::memory_order_relaxed);
+		ctx->values.resize(futures.size());
+		future<std::vector<T>> r = ctx->done.get_future();
+
+		for (std::size_t i = 0; i < futures.size(); i++)
+		{
+			futures[i].then([ctx, i](T&& v) {
+				ctx->values[i].emplace(std::move(v));
+				if (ctx->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					std::vector<T> out;
+					out.reserve(ctx->values.size());
+					for (auto& value : ctx->values)
+						out.push_back(std::move(*value));
+					ctx->done.set_value(std::move(out));
+				}
+			});
+		}
+		return r;
+	}
+
+	inline future<void> when_all(std::vector<future<void>>&& futures)
+	{
+		struct context
+		{
+			std::atomic<std::size_t> remaining;
+			promise<void>			 done;
+		};
+		if (futures.empty())
+			return make_ready_future<void>();
+
+		auto ctx = std::make_shared<context>();
+		ctx->remaining.store(futures.size(), std::memory_order_relaxed);
+		future<void> r = ctx->done.get_future();
+
+		for (auto& f : futures)
+		{
+			f.then([ctx]() {
+				if (ctx->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					ctx->done.set_value();
+			});
+		}
+		return r;
+	}
+
+	template <class T>
+	// completes with the index and value of the first future that is set
+	future<std::pair<std::size_t, T>> when_any(std::vector<future<T>>&& futures)
+	{
+		struct context
+		{
+			std::atomic<bool>					 set { false };
+			promise<std::pair<std::size_t, T>> done;
+		};
+		THREADING_ASSERT(futures.empty() == false);
+
+		auto							   ctx = std::make_shared<context>();
+		future<std::pair<std::size_t, T>> r = ctx->done.get_future();
+
+		for (std::size_t i = 0; i < futures.size(); i++)
+		{
+			futures[i].then([ctx, i](T&& v) {
+				if (ctx->set.exchange(true, std::memory_order_acq_rel) == false)
+					ctx->done.set_value(i, std::move(v));
+			});
+		}
+		return r;
+	}
+
+	inline future<std::size_t> when_any(std::vector<future<void>>&& futures)
+	{
+		struct context
+		{
+			std::atomic<bool>	 set { false };
+			promise<std::size_t> done;
+		};
+		THREADING_ASSERT(futures.empty() == false);
+
+		auto				ctx = std::make_shared<context>();
+		future<std::size_t> r = ctx->done.get_future();
+
+		for (std::size_t i = 0; i < futures.size(); i++)
+		{
+			futures[i].then([ctx, i]() {
+				if (ctx->set.exchange(true, std::memory_order_acq_rel) == false)
+					ctx->done.set_value(i);
+			});
+		}
+		return r;
+	}
+
+}
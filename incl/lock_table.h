@@ -0,0 +1,177 @@
+#pragma once
+
+#include "thread_primitives.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+
+namespace threading
+{
+
+	template <std::size_t N, class T = uint32_t>
+	// N spin_value_locks on separate cache lines, a key locks the stripe its hash maps to
+	// memory stays constant no matter how many keys there are, keys sharing a stripe serialize
+	// every stripe also holds a value (the spin_value_lock payload), available to the holder through the guard
+	struct lock_table
+	{
+	public:
+		static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+		using lock_t = spin_value_lock<T>;
+		using value_t = T;
+
+		static constexpr std::size_t stripe_count = N;
+
+	public:
+		// holds one stripe, move-only
+		struct guard
+		{
+		public:
+			guard(const guard&) = delete;
+			guard& operator=(const guard&) = delete;
+
+		public:
+			guard(lock_table& table, const std::size_t stripe)
+				: m_table(&table)
+				, m_stripe(stripe)
+				, value(table.m_locks[stripe]->lock())
+			{
+			}
+			guard(guard&& other) noexcept
+				: m_table(other.m_table)
+				, m_stripe(other.m_stripe)
+				, value(other.value)
+			{
+				other.m_table = nullptr;
+			}
+			~guard()
+			{
+				if (m_table != nullptr)
+					m_table->m_locks[m_stripe]->unlock(value);
+			}
+
+			inline std::size_t stripe() const
+			{
+				return m_stripe;
+			}
+
+		protected:
+			lock_table* m_table;
+			std::size_t m_stripe;
+
+		public:
+			value_t value; // written back on unlock
+		};
+
+		template <std::size_t M>
+		// holds up to M distinct stripes, acquired in ascending stripe order and released in reverse
+		struct multi_guard
+		{
+		public:
+			multi_guard(const multi_guard&) = delete;
+			multi_guard& operator=(const multi_guard&) = delete;
+
+		public:
+			multi_guard(lock_table& table, std::array<std::size_t, M> stripes)
+				: m_table(&table)
+			{
+				std::sort(stripes.begin(), stripes.end());
+				m_count = std::size_t(std::unique(stripes.begin(), stripes.end()) - stripes.begin());
+				for (std::size_t i = 0; i < m_count; i++)
+				{
+					m_stripes[i] = stripes[i];
+					m_values[i] = table.m_locks[stripes[i]]->lock();
+				}
+			}
+			multi_guard(multi_guard&& other) noexcept
+				: m_table(other.m_table)
+				, m_stripes(other.m_stripes)
+				, m_values(other.m_values)
+				, m_count(other.m_count)
+			{
+				other.m_table = nullptr;
+			}
+			~multi_guard()
+			{
+				if (m_table == nullptr)
+					return;
+				for (std::size_t i = m_count; i > 0; i--)
+					m_table->m_locks[m_stripes[i - 1]]->unlock(m_values[i - 1]);
+			}
+
+			// distinct stripes held, keys that share a stripe count once
+			inline std::size_t size() const
+			{
+				return m_count;
+			}
+
+			inline value_t& value_of(const std::size_t stripe)
+			{
+				for (std::size_t i = 0; i < m_count; i++)
+				{
+					if (m_stripes[i] == stripe)
+						return m_values[i];
+				}
+				THREADING_ASSERT_FALSE("stripe is not held");
+				return m_values[0];
+			}
+
+		protected:
+			lock_table*				   m_table;
+			std::array<std::size_t, M> m_stripes;
+			std::array<value_t, M>	   m_values;
+			std::size_t				   m_count = 0;
+		};
+
+	public:
+		lock_table(const lock_table&) = delete;
+		lock_table& operator=(const lock_table&) = delete;
+
+	public:
+		lock_table() = default;
+		explicit lock_table(const value_t initial) // every stripe starts with initial
+		{
+			for (auto& l : m_locks)
+				l->unlock(initial);
+		}
+
+	public:
+		template <class K, class H = std::hash<K>>
+		// fibonacci hashing on top of H, std::hash of integers is the identity
+		inline static std::size_t stripe_of(const K& key)
+		{
+			uint64_t h = uint64_t(H {}(key)) * 0x9E3779B97F4A7C15ull;
+			return std::size_t(h >> 32) & (N - 1);
+		}
+
+		template <class K>
+		inline guard lock(const K& key)
+		{
+			return guard(*this, stripe_of(key));
+		}
+
+		inline guard lock_stripe(const std::size_t stripe)
+		{
+			THREADING_ASSERT(stripe < N);
+			return guard(*this, stripe);
+		}
+
+		template <class... K>
+		// locks the stripes of all keys without deadlocking against other lock_many() calls
+		inline multi_guard<sizeof...(K)> lock_many(const K&... keys)
+		{
+			return multi_guard<sizeof...(K)>(*this, std::array<std::size_t, sizeof...(K)> { stripe_of(keys)... });
+		}
+
+		inline lock_t& stripe_lock(const std::size_t stripe)
+		{
+			THREADING_ASSERT(stripe < N);
+			return *m_locks[stripe];
+		}
+
+	protected:
+		std::array<cache_padded<lock_t>, N> m_locks;
+	};
+
+}
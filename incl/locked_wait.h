@@ -2,20 +2,37 @@
 
 #include "thread_primitives.h"
 
+#include <chrono>
+
 namespace threading
 {
 	// used by async pipe
+	// sleepers are woken last in, first out: the thread that went to sleep last still has warm caches, the ones idle the longest
+	// stay asleep and their cores can go idle; awake_*() are called with the root mutex locked
 	struct locked_wait
 	{
 	public:
 		void wait(threading::spin_lock& root_mutex, std::mutex& wait_mutex);
+		// false when timeout passed without a wakeup
+		bool wait_for(threading::spin_lock& root_mutex, std::mutex& wait_mutex, const std::chrono::nanoseconds timeout);
 
 		bool	 awake_one(std::mutex& parent_mutex);
 		uint32_t awake_all(std::mutex& parent_mutex);
 
 	protected:
-		int_fast32_t			m_await_counter = 0;
-		std::condition_variable m_sleep_trigger;
+		// lives on the stack of the sleeping thread
+		struct sleeper
+		{
+			sleeper*				next = nullptr;
+			bool					signaled = false; // guarded by the wait mutex
+			std::condition_variable trigger;
+		};
+
+		void _unlink(sleeper* s);
+
+	protected:
+		int_fast32_t m_await_counter = 0;
+		sleeper*	 m_sleepers = nullptr; // most recent first, guarded by the root mutex
 	};
 
 }
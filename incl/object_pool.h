@@ -0,0 +1,222 @@
+#pragma once
+
+#include "thread_primitives.h"
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace threading
+{
+
+	namespace detail
+	{
+		struct pool_cache;
+		struct thread_caches; // caches claimed by a thread, released at thread exit (src/object_pool.cpp)
+
+		// header in front of every pooled object
+		struct pool_node
+		{
+			pool_node*	next;
+			pool_cache* owner; // cache of the thread that carved the slab, the node always returns there
+		};
+
+		// per-thread part of a pool, owned by the pool and reused by another thread once its thread exits
+		struct pool_cache
+		{
+			pool_node*				m_free = nullptr; // owner thread only
+			std::atomic<pool_node*> m_remote { nullptr }; // nodes freed by other threads, taken all at once
+
+			// frees of nodes owned by another cache, returned as one chain
+			pool_cache* m_batch_owner = nullptr;
+			pool_node*	m_batch_head = nullptr;
+			pool_node*	m_batch_tail = nullptr;
+			uint32_t	m_batch_count = 0;
+
+			std::atomic<bool> m_claimed { false };
+
+			void flush_batch();
+		};
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// untyped part of object_pool
+	struct object_pool_base
+	{
+	public:
+		static constexpr uint32_t remote_batch = 32;
+
+	public:
+		object_pool_base(const object_pool_base&) = delete;
+		object_pool_base& operator=(const object_pool_base&) = delete;
+
+	public:
+		// pushes the remote frees this thread batched for other threads
+		void flush();
+
+		// slabs carved so far, constant once the pool serves a steady load from recycled objects
+		std::size_t slab_count();
+
+	protected:
+		object_pool_base(const std::size_t node_size, const std::size_t node_align, const std::size_t slab_nodes);
+		~object_pool_base(); // objects not returned to the pool are not destroyed
+
+		inline detail::pool_node* _alloc()
+		{
+			detail::pool_cache* c = _local_cache();
+			detail::pool_node*	n = nullptr;
+			if (c == nullptr || (n = c->m_free) == nullptr)
+				return _alloc_slow(c);
+			c->m_free = n->next;
+			return n;
+		}
+		inline void _free(detail::pool_node* n)
+		{
+			detail::pool_cache* c = _local_cache();
+			if (n->owner == c)
+			{
+				n->next = c->m_free;
+				c->m_free = n;
+				return;
+			}
+			_free_remote(c, n);
+		}
+
+		// nullptr once the thread released its caches (thread_local destructors that run after the release)
+		inline detail::pool_cache* _local_cache()
+		{
+			thread_cache_ref& ref = _last_used();
+			if (ref.id == m_id)
+				return ref.cache;
+			return _find_cache();
+		}
+
+	protected:
+		friend struct detail::thread_caches;
+
+		struct thread_cache_ref
+		{
+			uint64_t			id = 0;
+			detail::pool_cache* cache = nullptr;
+		};
+		static thread_cache_ref& _last_used();
+
+		detail::pool_cache* _find_cache();
+		detail::pool_cache* _claim_cache();
+		detail::pool_node*	_alloc_slow(detail::pool_cache* c);
+		detail::pool_node*	_refill(detail::pool_cache* c);
+		void				_free_remote(detail::pool_cache* c, detail::pool_node* n);
+
+	protected:
+		const std::size_t m_node_size;
+		const std::size_t m_node_align;
+		const std::size_t m_slab_nodes;
+		const uint64_t	  m_id; // never reused, lets threads tell a destroyed pool from a new one at the same address
+
+		std::mutex										 m_lock;
+		std::vector<std::unique_ptr<detail::pool_cache>> m_caches;
+		std::vector<void*>								 m_slabs;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T, std::size_t SLAB_SIZE = 64>
+	// fixed size allocator for T with a free list per thread
+	// objects go back to the thread that allocated them: directly when freed there, otherwise in batches of remote_batch
+	// through a lock-free list the owner takes as a whole when its own list runs dry
+	// slabs of SLAB_SIZE objects are cache line aligned and only released with the pool
+	struct object_pool : public object_pool_base
+	{
+	public:
+		struct deleter
+		{
+			object_pool* pool = nullptr;
+
+			inline void operator()(T* p) const
+			{
+				pool->destroy(p);
+			}
+		};
+		using handle = std::unique_ptr<T, deleter>;
+
+	public:
+		object_pool()
+			: object_pool_base(node_size, node_align, SLAB_SIZE)
+		{
+		}
+
+	public:
+		template <class... A>
+		T* create(A&&... args)
+		{
+			detail::pool_node* n = _alloc();
+			return new (reinterpret_cast<char*>(n) + header_size) T(std::forward<A>(args)...);
+		}
+		void destroy(T* p)
+		{
+			if (p == nullptr)
+				return;
+			p->~T();
+			_free(reinterpret_cast<detail::pool_node*>(reinterpret_cast<char*>(p) - header_size));
+		}
+
+		template <class... A>
+		inline handle make(A&&... args)
+		{
+			return handle(create(std::forward<A>(args)...), deleter { this });
+		}
+
+	protected:
+		static constexpr std::size_t _round_up(const std::size_t v, const std::size_t a)
+		{
+			return (v + a - 1) / a * a;
+		}
+
+		static constexpr std::size_t node_align = alignof(T) > alignof(detail::pool_node) ? alignof(T) : alignof(detail::pool_node);
+		static constexpr std::size_t header_size = _round_up(sizeof(detail::pool_node), alignof(T));
+		static constexpr std::size_t node_size = _round_up(header_size + sizeof(T), node_align);
+	};
+
+	template <class T>
+	using pooled_ptr = typename object_pool<T>::handle;
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	namespace detail
+	{
+		template <std::size_t SIZE>
+		// process wide pool of raw SIZE byte blocks (out-of-line unique_task callables, future states)
+		// blocks are usually taken on a producer and released on a consumer, object_pool sends them back in batches
+		// the pool is never destroyed, blocks may still be released during static destruction
+		struct block_pool
+		{
+		public:
+			struct alignas(std::max_align_t) block
+			{
+				block() // left uninitialized
+				{
+				}
+				unsigned char bytes[SIZE];
+			};
+
+		public:
+			inline static void* alloc()
+			{
+				return pool().create();
+			}
+			inline static void free(void* p)
+			{
+				pool().destroy(static_cast<block*>(p));
+			}
+
+			inline static object_pool<block>& pool()
+			{
+				static object_pool<block>* p = new object_pool<block>();
+				return *p;
+			}
+		};
+	}
+
+}
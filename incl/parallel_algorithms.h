@@ -0,0 +1,171 @@
+#pragma once
+
+#include "worker_pool.h"
+
+namespace threading
+{
+
+	// rounds grain up so chunks of T elements start and end on cache line boundaries (when the data is cache line aligned)
+	template <class T>
+	constexpr std::size_t cache_aligned_grain(const std::size_t grain)
+	{
+		return sizeof(T) >= cache_line_size
+				   ? (grain > 0 ? grain : 1)
+				   : (((grain > 0 ? grain : 1) + (cache_line_size / sizeof(T)) - 1) / (cache_line_size / sizeof(T))) * (cache_line_size / sizeof(T));
+	}
+
+	namespace detail
+	{
+		// chunks are contiguous and their bounds are multiples of grain, never strided
+		inline std::size_t parallel_chunk_end(const std::size_t begin, const std::size_t end, const std::size_t grain)
+		{
+			std::size_t r = (begin / grain + 1) * grain;
+			return r < end ? r : end;
+		}
+		inline std::size_t parallel_split_point(const std::size_t begin, const std::size_t end, const std::size_t grain)
+		{
+			std::size_t mid = ((begin + (end - begin) / 2) / grain) * grain;
+			if (mid <= begin)
+				mid = parallel_chunk_end(begin, end, grain);
+			return mid;
+		}
+
+		template <class F>
+		// void(std::size_t begin, std::size_t end)
+		// lazy binary splitting: the upper half of the range is exposed to other workers only when the local queue ran dry
+		void parallel_for_range(worker_pool& pool, join_counter& counter, std::size_t begin, std::size_t end, const std::size_t grain, const F& _func)
+		{
+			while (begin < end)
+			{
+				if (end - begin > grain && pool.local_queue_empty())
+				{
+					std::size_t mid = parallel_split_point(begin, end, grain);
+					if (mid < end)
+					{
+						counter.add(1);
+						pool.submit_local([&pool, &counter, mid, end, grain, &_func]() {
+							parallel_for_range(pool, counter, mid, end, grain, _func);
+							counter.done();
+						});
+						end = mid;
+						continue;
+					}
+				}
+				std::size_t chunk_end = parallel_chunk_end(begin, end, grain);
+				_func(begin, chunk_end);
+				begin = chunk_end;
+			}
+		}
+
+		template <class T>
+		struct alignas(cache_line_size) parallel_partial
+		{
+			threading::spin_lock lock;
+			bool				 set = false;
+			T					 value;
+		};
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class F>
+	// void(std::size_t begin, std::size_t end);
+	// runs _func on contiguous chunks of [begin, end), the calling thread takes part in the work
+	void parallel_for(worker_pool& pool, const std::size_t begin, const std::size_t end, const std::size_t grain, const F& _func)
+	{
+		if (begin >= end)
+			return;
+		join_counter counter;
+		detail::parallel_for_range(pool, counter, begin, end, grain > 0 ? grain : 1, _func);
+		pool.wait(counter);
+	}
+
+	template <class T, class F, class R>
+	// T _func(std::size_t begin, std::size_t end, const T& init); T _reduce(const T&, const T&);
+	// partial results are kept per thread, _reduce must be associative and commutative
+	T parallel_reduce(worker_pool& pool, const std::size_t begin, const std::size_t end, const std::size_t grain, const T& identity, const F& _func, const R& _reduce)
+	{
+		std::vector<detail::parallel_partial<T>> partials(pool.size() + 1);
+
+		parallel_for(pool, begin, end, grain, [&](const std::size_t b, const std::size_t e) {
+			T value = _func(b, e, identity);
+
+			auto& slot = partials[worker_pool::current() == &pool ? worker_pool::current_index() : pool.size()];
+			std::lock_guard<threading::spin_lock> _(slot.lock);
+			if (slot.set)
+			{
+				slot.value = _reduce(slot.value, value);
+			}
+			else
+			{
+				slot.value = std::move(value);
+				slot.set = true;
+			}
+		});
+
+		T result = identity;
+		for (auto& p : partials)
+		{
+			if (p.set)
+				result = _reduce(result, p.value);
+		}
+		return result;
+	}
+
+	template <class T, class F, class R>
+	// T _func(std::size_t begin, std::size_t end, const T& prefix, const bool final_pass); T _reduce(const T&, const T&);
+	// two passes over the same chunks: first pass (final_pass == false) returns the chunk total starting from identity,
+	// second pass (final_pass == true) receives the sum of all previous chunks and writes the results; returns the total
+	T parallel_scan(worker_pool& pool, const std::size_t begin, const std::size_t end, const std::size_t grain, const T& identity, const F& _func, const R& _reduce)
+	{
+		if (begin >= end)
+			return identity;
+
+		const std::size_t g = grain > 0 ? grain : 1;
+		// chunk count is bounded so the sequential prefix over chunk totals stays cheap
+		std::size_t chunk_size = g;
+		while ((end - begin) / chunk_size > pool.size() * 16)
+			chunk_size *= 2;
+
+		const std::size_t first_chunk = begin / chunk_size;
+		const std::size_t chunk_count = (end - 1) / chunk_size - first_chunk + 1;
+
+		std::vector<detail::parallel_partial<T>> partials(chunk_count);
+
+		auto chunk_bounds = [&](const std::size_t chunk, std::size_t& b, std::size_t& e) {
+			b = (first_chunk + chunk) * chunk_size;
+			e = b + chunk_size;
+			b = b < begin ? begin : b;
+			e = e > end ? end : e;
+		};
+
+		parallel_for(pool, 0, chunk_count, 1, [&](const std::size_t cb, const std::size_t ce) {
+			for (std::size_t c = cb; c < ce; c++)
+			{
+				std::size_t b, e;
+				chunk_bounds(c, b, e);
+				partials[c].value = _func(b, e, identity, false);
+			}
+		});
+
+		T total = identity;
+		for (auto& p : partials)
+		{
+			T chunk_total = std::move(p.value);
+			p.value = total;
+			total = _reduce(total, chunk_total);
+		}
+
+		parallel_for(pool, 0, chunk_count, 1, [&](const std::size_t cb, const std::size_t ce) {
+			for (std::size_t c = cb; c < ce; c++)
+			{
+				std::size_t b, e;
+				chunk_bounds(c, b, e);
+				_func(b, e, partials[c].value, true);
+			}
+		});
+
+		return total;
+	}
+
+}
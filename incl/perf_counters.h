@@ -0,0 +1,140 @@
+#pragma once
+
+#include "threading_config.h"
+
+#include <cstdint>
+
+// hardware counters of the calling thread (perf_event_open on linux), user space only
+//	threading::perf_sample s;
+//	{
+//		threading::perf_scope _(s);
+//		... region ...
+//	}
+//	s.ipc(), s.per(threading::perf_event::llc_misses, ops)
+// counters the kernel, the cpu or the permissions (perf_event_paranoid) do not allow are left out, has() tells which were counted;
+// other platforms count nothing
+
+namespace threading
+{
+
+	enum class perf_event : uint32_t
+	{
+		cycles,
+		instructions,
+		llc_misses,
+		cache_line_transfers, // loads served from a modified line in another core's cache (HITM), intel only
+		context_switches,
+		count
+	};
+
+	struct perf_sample
+	{
+		uint64_t values[uint32_t(perf_event::count)] = {};
+		uint64_t time_enabled = 0; // ns the hardware counters were enabled, they share one group and one schedule
+		uint64_t time_running = 0; // ns they actually counted, less than enabled when the kernel multiplexed them
+		uint32_t available = 0; // bit per perf_event
+		uint32_t samples = 0; // reads or regions summed up
+
+		inline bool has(const perf_event e) const
+		{
+			return (available & (1u << uint32_t(e))) != 0;
+		}
+		inline uint64_t operator[](const perf_event e) const
+		{
+			return values[uint32_t(e)];
+		}
+
+		// instructions per cycle, 0 without both counters
+		inline double ipc() const
+		{
+			if (has(perf_event::cycles) == false || has(perf_event::instructions) == false || values[uint32_t(perf_event::cycles)] == 0)
+				return 0.0;
+			return double(values[uint32_t(perf_event::instructions)]) / double(values[uint32_t(perf_event::cycles)]);
+		}
+
+		// per operation, -1 when not counted
+		inline double per(const perf_event e, const uint64_t operations) const
+		{
+			if (has(e) == false || operations == 0)
+				return -1.0;
+			return double(values[uint32_t(e)]) / double(operations);
+		}
+
+		// accumulates regions, possibly of several threads; only counters present in both stay available
+		perf_sample& operator+=(const perf_sample& other)
+		{
+			available = samples == 0 ? other.available : (available & other.available);
+			samples += other.samples;
+			time_enabled += other.time_enabled;
+			time_running += other.time_running;
+			for (uint32_t i = 0; i < uint32_t(perf_event::count); i++)
+				values[i] += other.values[i];
+			return *this;
+		}
+	};
+
+	struct perf_counters
+	{
+	public:
+		perf_counters(const perf_counters&) = delete;
+		perf_counters& operator=(const perf_counters&) = delete;
+
+	public:
+		// counts the calling thread from now on, must be read by the same thread
+		perf_counters();
+		~perf_counters();
+
+		// raw running totals, read at once for the whole group
+		perf_sample read() const;
+
+		// end - begin, scaled up to the enabled time when the group was multiplexed within the region
+		// a counter that went backwards gives 0; counters of a group that never ran are left out
+		static perf_sample delta(const perf_sample& begin, const perf_sample& end);
+
+		inline bool available() const
+		{
+			return m_available != 0;
+		}
+		inline bool has(const perf_event e) const
+		{
+			return (m_available & (1u << uint32_t(e))) != 0;
+		}
+
+		// counters of the calling thread, opened on first use and kept until the thread exits
+		static perf_counters& this_thread();
+
+		static const char* name(const perf_event e);
+
+	protected:
+		int		   m_fds[uint32_t(perf_event::count)];
+		perf_event m_group[uint32_t(perf_event::count)]; // hardware events in the order they joined the group, m_group[0] leads
+		uint32_t   m_group_size = 0;
+		uint32_t   m_available = 0;
+	};
+
+	// adds what the calling thread's counters moved between construction and destruction to a sample
+	struct perf_scope
+	{
+	public:
+		perf_scope(const perf_scope&) = delete;
+		perf_scope& operator=(const perf_scope&) = delete;
+
+	public:
+		explicit perf_scope(perf_sample& out)
+			: m_out(out)
+			, m_counters(perf_counters::this_thread())
+			, m_begin(m_counters.read())
+		{
+		}
+		~perf_scope()
+		{
+			m_out += perf_counters::delta(m_begin, m_counters.read());
+		}
+
+	protected:
+		perf_sample&	   m_out;
+		perf_counters&	   m_counters;
+		const perf_sample m_begin;
+	};
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "thread_primitives.h"
+
+#include <array>
+#include <deque>
+
+namespace threading
+{
+
+	// item storage policies for async_pipe, always accessed under the pipe lock
+	// interface: size(), push(T&&), push(const T&), T pop() (size() > 0), clear()
+
+	template <class T>
+	// default storage, newest item first
+	struct pipe_stack
+	{
+	public:
+		inline std::size_t size() const
+		{
+			return m_items.size();
+		}
+		inline void push(T&& item)
+		{
+			m_items.push_back(std::move(item));
+		}
+		inline void push(const T& item)
+		{
+			m_items.push_back(item);
+		}
+		inline T pop()
+		{
+			T r = std::move(m_items.back());
+			m_items.pop_back();
+			return r;
+		}
+		inline void clear()
+		{
+			m_items.clear();
+		}
+
+	protected:
+		std::vector<T> m_items;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T, std::size_t LANES>
+	// LANES FIFO lanes, lane 0 has the highest priority
+	// a lower lane that was passed over starvation_limit times while holding items is served next (aging)
+	struct priority_lanes
+	{
+	public:
+		static_assert(LANES > 0, "at least one lane is required");
+
+		static constexpr std::size_t lane_count = LANES;
+		static constexpr uint32_t	 default_starvation_limit = 64;
+
+	public:
+		explicit priority_lanes(const uint32_t starvation_limit = default_starvation_limit)
+			: m_starvation_limit(starvation_limit)
+		{
+			for (std::size_t i = 0; i < LANES; i++)
+			{
+				m_depth[i].store(0, std::memory_order_relaxed);
+				m_skipped[i] = 0;
+			}
+		}
+
+	public:
+		inline std::size_t size() const
+		{
+			return m_size;
+		}
+		inline void push(T&& item, const std::size_t lane = LANES - 1)
+		{
+			THREADING_ASSERT(lane < LANES);
+			m_lanes[lane].push_back(std::move(item));
+			_added(lane);
+		}
+		inline void push(const T& item, const std::size_t lane = LANES - 1)
+		{
+			THREADING_ASSERT(lane < LANES);
+			m_lanes[lane].push_back(item);
+			_added(lane);
+		}
+		inline T pop()
+		{
+			THREADING_ASSERT(m_size > 0);
+
+			std::size_t lane = LANES;
+			std::size_t starving = LANES;
+			for (std::size_t i = 0; i < LANES; i++)
+			{
+				if (m_lanes[i].empty())
+					continue;
+				if (lane == LANES)
+					lane = i;
+				else if (m_skipped[i] >= m_starvation_limit && (starving == LANES || m_skipped[i] > m_skipped[starving]))
+					starving = i;
+			}
+			if (starving != LANES)
+				lane = starving;
+
+			for (std::size_t i = 0; i < LANES; i++)
+			{
+				if (i != lane && m_lanes[i].empty() == false)
+					m_skipped[i]++;
+			}
+			m_skipped[lane] = 0;
+
+			T r = std::move(m_lanes[lane].front());
+			m_lanes[lane].pop_front();
+			m_size--;
+			m_depth[lane].store(m_lanes[lane].size(), std::memory_order_relaxed);
+			return r;
+		}
+		inline void clear()
+		{
+			for (std::size_t i = 0; i < LANES; i++)
+			{
+				m_lanes[i].clear();
+				m_skipped[i] = 0;
+				m_depth[i].store(0, std::memory_order_relaxed);
+			}
+			m_size = 0;
+		}
+
+	public:
+		// can be read without the pipe lock
+		inline std::size_t depth(const std::size_t lane) const
+		{
+			THREADING_ASSERT(lane < LANES);
+			return m_depth[lane].load(std::memory_order_relaxed);
+		}
+
+	protected:
+		inline void _added(const std::size_t lane)
+		{
+			m_size++;
+			m_depth[lane].store(m_lanes[lane].size(), std::memory_order_relaxed);
+		}
+
+	protected:
+		std::array<std::deque<T>, LANES>			  m_lanes;
+		std::array<uint32_t, LANES>					  m_skipped;
+		std::array<std::atomic<std::size_t>, LANES> m_depth;
+		std::size_t									  m_size = 0;
+		const uint32_t								  m_starvation_limit;
+	};
+
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "worker_pool.h"
+
+#include <functional>
+
+namespace threading
+{
+
+	enum class stage_mode
+	{
+		parallel, // any number of items at once
+		serial_in_order, // one item at a time, in the order the source produced them
+		serial_out_of_order, // one item at a time, in arrival order
+	};
+
+	template <class T>
+	// chain of stages over items of type T, run on a worker_pool (like a TBB pipeline)
+	// at most max_tokens items are in flight, each one lives in a preallocated slot that is reused once the item left the last stage
+	// the thread that finishes a stage carries the item into the next one; an item that has to wait for a serial stage is parked
+	// there and picked up by the thread that leaves that stage
+	struct pipeline
+	{
+	public:
+		using source_t = std::function<bool(T&)>; // fills the slot, false when there is no more input
+		using stage_t = std::function<void(T&)>;
+
+	public:
+		pipeline(const pipeline&) = delete;
+		pipeline& operator=(const pipeline&) = delete;
+
+	public:
+		pipeline() = default;
+
+	public:
+		// the source is a serial in-order stage in front of all other stages
+		inline pipeline& source(source_t&& _func)
+		{
+			m_source = std::move(_func);
+			return *this;
+		}
+
+		inline pipeline& stage(const stage_mode mode, stage_t&& _func)
+		{
+			m_stages.emplace_back(mode, std::move(_func));
+			return *this;
+		}
+
+		inline std::size_t size() const
+		{
+			return m_stages.size();
+		}
+
+	public:
+		// runs until the source returns false and all items passed all stages
+		void run(worker_pool& pool, const uint32_t max_tokens)
+		{
+			THREADING_ASSERT(m_source != nullptr);
+			THREADING_ASSERT(max_tokens > 0);
+
+			_reset(max_tokens);
+
+			join_counter running(1); // the source, plus one for every item in flight
+			m_pool = &pool;
+			m_running = &running;
+
+			m_input_claimed = true;
+			pool.submit_local([this]() { _run_input(); });
+			pool.wait(running);
+
+			m_pool = nullptr;
+			m_running = nullptr;
+		}
+
+	protected:
+		static constexpr uint32_t invalid_slot = std::numeric_limits<uint32_t>::max();
+
+		struct token
+		{
+			T		 item {};
+			uint64_t seq = 0;
+		};
+
+		struct stage_info
+		{
+			stage_info(const stage_mode m, stage_t&& _func)
+				: mode(m)
+				, work(std::move(_func))
+			{
+			}
+
+			const stage_mode mode;
+			stage_t			 work;
+
+			threading::spin_lock  lock;
+			bool				  busy = false;
+			uint64_t			  next_seq = 0; // serial_in_order
+			std::vector<uint32_t> parked; // serial_in_order: by seq % max_tokens, serial_out_of_order: FIFO ring
+			std::size_t			  parked_head = 0;
+			std::size_t			  parked_count = 0;
+		};
+
+	protected:
+		void _reset(const uint32_t max_tokens)
+		{
+			m_tokens.clear();
+			m_tokens.resize(max_tokens);
+			m_free.clear();
+			for (uint32_t i = max_tokens; i > 0; i--)
+				m_free.push_back(i - 1);
+			m_next_seq = 0;
+			m_source_done = false;
+
+			for (auto& s : m_stages)
+			{
+				s.busy = false;
+				s.next_seq = 0;
+				s.parked.assign(max_tokens, invalid_slot);
+				s.parked_head = 0;
+				s.parked_count = 0;
+			}
+		}
+
+		// called with the input claimed, see _claim_input()
+		void _run_input()
+		{
+			uint32_t slot;
+			{
+				std::lock_guard<threading::spin_lock> _(m_input_lock);
+				THREADING_ASSERT(m_free.empty() == false);
+				slot = m_free.back();
+				m_free.pop_back();
+			}
+
+			token& t = m_tokens[slot];
+			if (m_source(t.item) == false)
+			{
+				{
+					std::lock_guard<threading::spin_lock> _(m_input_lock);
+					m_free.push_back(slot);
+					m_source_done = true;
+					m_input_claimed = false;
+				}
+				m_running->done();
+				return;
+			}
+			t.seq = m_next_seq++;
+			m_running->add(1);
+
+			// keep the source busy while there are free slots, this thread stays with the new item
+			bool more;
+			{
+				std::lock_guard<threading::spin_lock> _(m_input_lock);
+				more = m_free.empty() == false;
+				m_input_claimed = more;
+			}
+			if (more)
+				m_pool->submit_local([this]() { _run_input(); });
+
+			_run_token(slot, 0, false);
+		}
+
+		// claims the input for the calling thread if it is idle and a slot is free
+		inline bool _claim_input()
+		{
+			std::lock_guard<threading::spin_lock> _(m_input_lock);
+			if (m_input_claimed || m_source_done || m_free.empty())
+				return false;
+			m_input_claimed = true;
+			return true;
+		}
+
+		void _run_token(const uint32_t slot, std::size_t stage, bool entered)
+		{
+			token& t = m_tokens[slot];
+			for (; stage < m_stages.size(); stage++)
+			{
+				stage_info& s = m_stages[stage];
+				if (entered == false && _enter(s, slot, t.seq) == false)
+					return; // parked, continued by the thread leaving the stage
+				entered = false;
+
+				s.work(t.item);
+
+				uint32_t next = _leave(s);
+				if (next != invalid_slot)
+				{
+					const std::size_t st = stage;
+					m_pool->submit_local([this, next, st]() { _run_token(next, st, true); });
+				}
+			}
+
+			{
+				std::lock_guard<threading::spin_lock> _(m_input_lock);
+				m_free.push_back(slot);
+			}
+			bool input = _claim_input();
+			m_running->done(); // the claimed input still holds the count of the source
+			if (input)
+				_run_input();
+		}
+
+		inline bool _enter(stage_info& s, const uint32_t slot, const uint64_t seq)
+		{
+			if (s.mode == stage_mode::parallel)
+				return true;
+
+			std::lock_guard<threading::spin_lock> _(s.lock);
+			const std::size_t					  capacity = s.parked.size();
+			if (s.mode == stage_mode::serial_in_order)
+			{
+				if (s.busy || seq != s.next_seq)
+				{
+					s.parked[seq % capacity] = slot;
+					return false;
+				}
+			}
+			else if (s.busy)
+			{
+				s.parked[(s.parked_head + s.parked_count) % capacity] = slot;
+				s.parked_count++;
+				return false;
+			}
+			s.busy = true;
+			return true;
+		}
+
+		// returns a parked slot that now owns the stage, or invalid_slot
+		inline uint32_t _leave(stage_info& s)
+		{
+			if (s.mode == stage_mode::parallel)
+				return invalid_slot;
+
+			std::lock_guard<threading::spin_lock> _(s.lock);
+			const std::size_t					  capacity = s.parked.size();
+			uint32_t							  next = invalid_slot;
+			if (s.mode == stage_mode::serial_in_order)
+			{
+				s.next_seq++;
+				std::swap(next, s.parked[s.next_seq % capacity]);
+			}
+			else if (s.parked_count > 0)
+			{
+				next = s.parked[s.parked_head];
+				s.parked_head = (s.parked_head + 1) % capacity;
+				s.parked_count--;
+			}
+			s.busy = next != invalid_slot;
+			return next;
+		}
+
+	protected:
+		source_t			   m_source;
+		std::deque<stage_info> m_stages; // stable addresses
+
+		std::vector<token> m_tokens;
+		uint64_t		   m_next_seq = 0; // only touched by the thread that claimed the input
+
+		threading::spin_lock  m_input_lock;
+		std::vector<uint32_t> m_free;
+		bool				  m_input_claimed = false;
+		bool				  m_source_done = false;
+
+		worker_pool*  m_pool = nullptr;
+		join_counter* m_running = nullptr;
+	};
+
+}
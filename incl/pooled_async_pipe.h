@@ -0,0 +1,48 @@
+#pragma once
+
+#include "async_pipe.h"
+#include "object_pool.h"
+
+namespace threading
+{
+
+	namespace detail
+	{
+		template <class T>
+		// base of pooled_async_pipe, constructed before and destroyed after the pipe holding its objects
+		struct pool_holder
+		{
+			object_pool<T> m_pool;
+		};
+	}
+
+	template <class T, class STORAGE = pipe_stack<pooled_ptr<T>>>
+	// async_pipe of pooled objects: producers allocate from the pool, consumers release by dropping the handle
+	struct pooled_async_pipe
+		: protected detail::pool_holder<T>
+		, public async_pipe<pooled_ptr<T>, STORAGE>
+	{
+	public:
+		using async_pipe<pooled_ptr<T>, STORAGE>::async_pipe;
+
+	public:
+		inline object_pool<T>& pool()
+		{
+			return this->m_pool;
+		}
+
+		template <class... A>
+		inline pooled_ptr<T> make(A&&... args)
+		{
+			return this->m_pool.make(std::forward<A>(args)...);
+		}
+
+		template <class... A>
+		// constructs the item in the pool, storage arguments (a lane) are pushed with push_back(make(...), lane)
+		inline bool emplace_back(A&&... args)
+		{
+			return this->push_back(this->m_pool.make(std::forward<A>(args)...));
+		}
+	};
+
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "thread_primitives.h"
+
+#include <memory>
+#include <new>
+
+namespace threading
+{
+
+	template <class T, bool BLOCKING = true>
+	// bounded ring for exactly one producer thread and one consumer thread, try_* calls are wait-free
+	// each side keeps a copy of the other side's index and only reloads it when the ring looks full/empty
+	// try_stage() + publish() make a batch of items visible with one store, consume_all() releases a batch of slots with one store
+	// BLOCKING adds push()/pop() that sleep on an event_count; without it no fence or waiter check is done per publish
+	struct spsc_queue
+	{
+	public:
+		static constexpr uint32_t spin_count = 64; // failed try_* calls before push()/pop() go to sleep
+
+	public:
+		spsc_queue(const spsc_queue&) = delete;
+		spsc_queue& operator=(const spsc_queue&) = delete;
+
+	public:
+		explicit spsc_queue(const std::size_t capacity) // rounded up to a power of two
+			: m_capacity(_round_capacity(capacity))
+			, m_mask(m_capacity - 1)
+			, m_slots(static_cast<slot*>(::operator new(sizeof(slot) * m_capacity, std::align_val_t(alignof(slot)))))
+		{
+		}
+		~spsc_queue()
+		{
+			for (std::size_t i = m_consumer.head.load(std::memory_order_relaxed); i != m_producer.staged; i++)
+				_at(i)->~T();
+			::operator delete(m_slots, std::align_val_t(alignof(slot)));
+		}
+
+	public:
+		// for the producer
+
+		// writes item without making it visible to the consumer, false when full
+		template <class U>
+		bool try_stage(U&& item)
+		{
+			const std::size_t t = m_producer.staged;
+			if (t - m_producer.head_cache == m_capacity)
+			{
+				m_producer.head_cache = m_consumer.head.load(std::memory_order_acquire);
+				if (t - m_producer.head_cache == m_capacity)
+					return false;
+			}
+			new (&m_slots[t & m_mask]) T(std::forward<U>(item));
+			m_producer.staged = t + 1;
+			return true;
+		}
+
+		// makes all staged items visible
+		void publish()
+		{
+			if (m_producer.staged == m_producer.tail.load(std::memory_order_relaxed))
+				return;
+			m_producer.tail.store(m_producer.staged, std::memory_order_release);
+			if constexpr (BLOCKING)
+				m_not_empty.notify_one();
+		}
+
+		template <class U>
+		inline bool try_push(U&& item)
+		{
+			if (try_stage(std::forward<U>(item)) == false)
+				return false;
+			publish();
+			return true;
+		}
+
+		template <class U>
+		// publishes staged items and waits while the ring is full; false when the queue was closed
+		bool push(U&& item)
+		{
+			static_assert(BLOCKING, "push() needs a blocking queue");
+			while (m_closed.load(std::memory_order_relaxed) == false)
+			{
+				for (uint32_t i = 0; i < spin_count; i++)
+				{
+					if (try_push(std::forward<U>(item)))
+						return true;
+				}
+				publish();
+				_wait(m_not_full, [this]() { return _full(); });
+			}
+			return false;
+		}
+
+	public:
+		// for the consumer
+
+		bool try_pop(T& out)
+		{
+			const std::size_t h = m_consumer.head.load(std::memory_order_relaxed);
+			if (_available(h) == false)
+				return false;
+			T* p = _at(h);
+			out = std::move(*p);
+			p->~T();
+			_release(h + 1);
+			return true;
+		}
+
+		template <class F>
+		// void(T&&) for every visible item, the slots are handed back to the producer once at the end
+		std::size_t consume_all(const F& _func)
+		{
+			const std::size_t h = m_consumer.head.load(std::memory_order_relaxed);
+			if (_available(h) == false)
+				return 0;
+			const std::size_t t = m_consumer.tail_cache;
+			for (std::size_t i = h; i != t; i++)
+			{
+				T* p = _at(i);
+				_func(std::move(*p));
+				p->~T();
+			}
+			_release(t);
+			return t - h;
+		}
+
+		// waits until an item is available; false when the queue was closed and is drained
+		bool pop(T& out)
+		{
+			static_assert(BLOCKING, "pop() needs a blocking queue");
+			while (true)
+			{
+				for (uint32_t i = 0; i < spin_count; i++)
+				{
+					if (try_pop(out))
+						return true;
+				}
+				if (m_closed.load(std::memory_order_acquire))
+					return try_pop(out);
+				_wait(m_not_empty, [this]() { return _empty(); });
+			}
+		}
+
+	public:
+		// wakes both sides; push() fails from now on, pop() fails once the published items are consumed
+		// staged items are not published, the producer calls publish() before close() to keep them
+		void close()
+		{
+			m_closed.store(true, std::memory_order_release);
+			if constexpr (BLOCKING)
+			{
+				m_not_empty.notify_all();
+				m_not_full.notify_all();
+			}
+		}
+		inline bool closed() const
+		{
+			return m_closed.load(std::memory_order_acquire);
+		}
+
+		inline std::size_t capacity() const
+		{
+			return m_capacity;
+		}
+
+	protected:
+		union slot
+		{
+			slot()
+			{
+			}
+			~slot()
+			{
+			}
+			T value;
+		};
+
+		static std::size_t _round_capacity(const std::size_t capacity)
+		{
+			std::size_t r = 2;
+			while (r < capacity)
+				r *= 2;
+			return r;
+		}
+
+		inline T* _at(const std::size_t index)
+		{
+			return &m_slots[index & m_mask].value;
+		}
+
+		inline bool _available(const std::size_t h)
+		{
+			if (h != m_consumer.tail_cache)
+				return true;
+			m_consumer.tail_cache = m_producer.tail.load(std::memory_order_acquire);
+			return h != m_consumer.tail_cache;
+		}
+
+		inline void _release(const std::size_t new_head)
+		{
+			m_consumer.head.store(new_head, std::memory_order_release);
+			if constexpr (BLOCKING)
+				m_not_full.notify_one();
+		}
+
+		inline bool _empty() const
+		{
+			return m_consumer.head.load(std::memory_order_relaxed) == m_producer.tail.load(std::memory_order_acquire);
+		}
+		inline bool _full() const
+		{
+			return m_producer.staged - m_consumer.head.load(std::memory_order_acquire) == m_capacity;
+		}
+
+		template <class F>
+		inline void _wait(event_count& ec, const F& _blocked)
+		{
+			const event_count::key_t key = ec.prepare_wait();
+			if (_blocked() && m_closed.load(std::memory_order_relaxed) == false)
+				ec.commit_wait(key);
+			else
+				ec.cancel_wait();
+		}
+
+	protected:
+		struct alignas(cache_line_size) producer_side
+		{
+			std::atomic<std::size_t> tail { 0 }; // published
+			std::size_t				 staged = 0;
+			std::size_t				 head_cache = 0;
+		};
+		struct alignas(cache_line_size) consumer_side
+		{
+			std::atomic<std::size_t> head { 0 };
+			std::size_t				 tail_cache = 0;
+		};
+
+		producer_side m_producer;
+		consumer_side m_consumer;
+
+		alignas(cache_line_size) const std::size_t m_capacity;
+		const std::size_t m_mask;
+		slot* const		  m_slots;
+
+		// slow path of the blocking calls
+		alignas(cache_line_size) std::atomic<bool> m_closed { false };
+		event_count m_not_empty;
+		event_count m_not_full;
+	};
+
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "thread_primitives.h"
+
+#include <limits>
+#include <memory>
+
+namespace threading
+{
+
+	namespace detail
+	{
+		// stripe of the calling thread, threads are numbered round robin on first use
+		inline std::size_t striped_thread_slot()
+		{
+			static std::atomic<std::size_t> next { 0 };
+			static thread_local std::size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+			return slot;
+		}
+
+		inline std::size_t striped_default_cells()
+		{
+			std::size_t n = std::thread::hardware_concurrency();
+			std::size_t r = 1;
+			while (r < n && r < 64)
+				r *= 2;
+			return r;
+		}
+
+		template <class T, class OP>
+		// cells on separate cache lines, a thread always writes the same cell
+		struct striped_cells
+		{
+		public:
+			using cell_t = cache_padded<std::atomic<T>>;
+
+		public:
+			explicit striped_cells(const std::size_t cell_count)
+				: m_mask(_round(cell_count) - 1)
+				, m_cells(new cell_t[m_mask + 1])
+			{
+				reset();
+			}
+
+		public:
+			inline std::atomic<T>& local()
+			{
+				return *m_cells[striped_thread_slot() & m_mask];
+			}
+
+			// not a snapshot, concurrent updates may or may not be included
+			inline T load() const
+			{
+				T r = OP::identity();
+				for (std::size_t i = 0; i <= m_mask; i++)
+					r = OP::combine(r, m_cells[i]->load(std::memory_order_relaxed));
+				return r;
+			}
+
+			inline void reset()
+			{
+				for (std::size_t i = 0; i <= m_mask; i++)
+					m_cells[i]->store(OP::identity(), std::memory_order_relaxed);
+			}
+
+			inline std::size_t cell_count() const
+			{
+				return m_mask + 1;
+			}
+
+		protected:
+			static std::size_t _round(const std::size_t n)
+			{
+				std::size_t r = 1;
+				while (r < n)
+					r *= 2;
+				return r;
+			}
+
+		protected:
+			const std::size_t		   m_mask;
+			std::unique_ptr<cell_t[]> m_cells;
+		};
+
+		template <class T>
+		struct striped_sum_op
+		{
+			static constexpr T identity()
+			{
+				return T(0);
+			}
+			static constexpr T combine(const T a, const T b)
+			{
+				return a + b;
+			}
+		};
+		template <class T>
+		struct striped_max_op
+		{
+			static constexpr T identity()
+			{
+				return std::numeric_limits<T>::lowest();
+			}
+			static constexpr T combine(const T a, const T b)
+			{
+				return a < b ? b : a;
+			}
+		};
+		template <class T>
+		struct striped_min_op
+		{
+			static constexpr T identity()
+			{
+				return std::numeric_limits<T>::max();
+			}
+			static constexpr T combine(const T a, const T b)
+			{
+				return b < a ? b : a;
+			}
+		};
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T = uint64_t>
+	// counter for statistics written by many threads: add() is a relaxed increment of the caller's own cell, load() sums the cells
+	// use it instead of a single std::atomic when the increments happen on hot paths of many cores
+	struct striped_counter
+	{
+	public:
+		striped_counter(const striped_counter&) = delete;
+		striped_counter& operator=(const striped_counter&) = delete;
+
+	public:
+		explicit striped_counter(const std::size_t cell_count = detail::striped_default_cells())
+			: m_cells(cell_count)
+		{
+		}
+
+	public:
+		inline void add(const T value)
+		{
+			m_cells.local().fetch_add(value, std::memory_order_relaxed);
+		}
+		inline void sub(const T value)
+		{
+			m_cells.local().fetch_sub(value, std::memory_order_relaxed);
+		}
+		inline striped_counter& operator+=(const T value)
+		{
+			add(value);
+			return *this;
+		}
+		inline striped_counter& operator++()
+		{
+			add(1);
+			return *this;
+		}
+
+		inline T load() const
+		{
+			return m_cells.load();
+		}
+		// not atomic with concurrent add() calls
+		inline void reset()
+		{
+			m_cells.reset();
+		}
+
+		inline std::size_t cell_count() const
+		{
+			return m_cells.cell_count();
+		}
+
+	protected:
+		detail::striped_cells<T, detail::striped_sum_op<T>> m_cells;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <class T, class OP>
+	// running maximum/minimum, a cell is only written when the value improves on what the caller's cell already holds
+	struct striped_extreme
+	{
+	public:
+		striped_extreme(const striped_extreme&) = delete;
+		striped_extreme& operator=(const striped_extreme&) = delete;
+
+	public:
+		explicit striped_extreme(const std::size_t cell_count = detail::striped_default_cells())
+			: m_cells(cell_count)
+		{
+		}
+
+	public:
+		inline void update(const T value)
+		{
+			std::atomic<T>& c = m_cells.local();
+			T				current = c.load(std::memory_order_relaxed);
+			while (OP::combine(current, value) != current)
+			{
+				if (c.compare_exchange_weak(current, value, std::memory_order_relaxed))
+					break;
+			}
+		}
+
+		// identity (lowest()/max()) when nothing was recorded
+		inline T load() const
+		{
+			return m_cells.load();
+		}
+		inline void reset()
+		{
+			m_cells.reset();
+		}
+
+	protected:
+		detail::striped_cells<T, OP> m_cells;
+	};
+
+	template <class T = uint64_t>
+	using striped_max = striped_extreme<T, detail::striped_max_op<T>>;
+	template <class T = uint64_t>
+	using striped_min = striped_extreme<T, detail::striped_min_op<T>>;
+
+}
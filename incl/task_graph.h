@@ -0,0 +1,99 @@
+#pragma once
+
+#include "worker_pool.h"
+
+namespace threading
+{
+
+	// graph of dependent tasks executed on a worker_pool
+	// nodes and edges are allocated once, the graph can be run any number of times without reallocating
+	struct task_graph
+	{
+	public:
+		struct node
+		{
+		public:
+			node(const node&) = delete;
+			node& operator=(const node&) = delete;
+
+		public:
+			template <class F>
+			node(task_graph& graph, F&& _func)
+				: m_graph(graph)
+				, m_work(std::forward<F>(_func))
+			{
+			}
+
+		public:
+			// this node must complete before successor starts
+			void precede(node& successor);
+
+			template <class... N>
+			inline void precede(node& successor, node& other, N&... rest)
+			{
+				precede(successor);
+				precede(other, rest...);
+			}
+
+			inline void succeed(node& predecessor)
+			{
+				predecessor.precede(*this);
+			}
+
+		protected:
+			friend struct task_graph;
+
+			task_graph&				  m_graph;
+			unique_task				  m_work;
+			std::vector<node*>		  m_successors;
+			uint32_t				  m_predecessor_count = 0;
+			std::atomic<uint32_t>	  m_pending { 0 };
+		};
+
+	public:
+		task_graph(const task_graph&) = delete;
+		task_graph& operator=(const task_graph&) = delete;
+
+	public:
+		task_graph() = default;
+		~task_graph();
+
+	public:
+		template <class F>
+		// void();
+		inline node& emplace(F&& _func)
+		{
+			THREADING_ASSERT(m_pool == nullptr);
+			m_nodes.emplace_back(*this, std::forward<F>(_func));
+			return m_nodes.back();
+		}
+
+		inline std::size_t size() const
+		{
+			return m_nodes.size();
+		}
+
+		// false when the edges form a cycle, such a graph never completes; checked once after edges were added
+		bool acyclic();
+
+	public:
+		// run the graph and wait for all nodes to complete; false (and nothing runs) when the graph has a cycle
+		bool run(worker_pool& pool);
+
+		// submit the root nodes and return immediately, call wait() before running again or destroying the graph
+		// false (and nothing is submitted) when the graph has a cycle
+		bool run_async(worker_pool& pool);
+		void wait();
+
+	protected:
+		void _execute(node* n);
+
+	protected:
+		std::deque<node> m_nodes; // stable addresses
+		join_counter	 m_running;
+		worker_pool*	 m_pool = nullptr;
+		bool			 m_acyclic = true; // valid while m_checked
+		bool			 m_checked = true; // no edge added since the last acyclic()
+	};
+
+}
@@ -1,10 +1,26 @@
-
 #pragma once
 #include "thread_primitives.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace threading
 {
 
+	// what the OS knows about one thread; fields the platform does not provide stay at their defaults
+	struct thread_stats
+	{
+		std::string name;
+		int64_t		os_id = 0; // tid on linux
+		uint64_t	cpu_time_ns = 0;
+		uint64_t	voluntary_switches = 0; // blocked or yielded
+		uint64_t	involuntary_switches = 0; // preempted
+		uint64_t	migrations = 0; // moves to another cpu, needs CONFIG_SCHED_DEBUG for /proc/<tid>/sched
+		int32_t		current_cpu = -1; // last cpu the thread ran on
+		bool		finished = false; // values are the last ones the thread saw of itself
+	};
+
 	struct thread_group
 	{
 	public:
@@ -16,12 +32,25 @@ namespace threading
 
 		template <class F>
 		inline void spawn(const std::size_t count, const F& _func)
+		{
+			spawn_named(nullptr, count, _func);
+		}
+
+		template <class F>
+		// workers are called "name-<index in the group>" (the OS keeps 15 characters on linux)
+		inline void spawn_named(const char* name, const std::size_t count, const F& _func)
 		{
 			std::size_t sz = m_thread_handles.size();
 			m_thread_handles.resize(sz + count);
 			for (std::size_t i = 0; i < count; i++)
 			{
-				threading::utils::start_native(m_thread_handles[sz + i], _func);
+				m_workers.emplace_back(new worker(name != nullptr ? std::string(name) + "-" + std::to_string(sz + i) : std::string()));
+				worker* w = m_workers.back().get();
+				threading::utils::start_native(m_thread_handles[sz + i], [w, _func]() {
+					_begin_worker(*w);
+					_func();
+					_end_worker(*w);
+				});
 			}
 		}
 
@@ -30,8 +59,33 @@ namespace threading
 			return m_thread_handles.size();
 		}
 
+		thread_stats stats(const std::size_t index) const;
+		std::vector<thread_stats> stats() const;
+
+		// the calling thread, any thread
+		static thread_stats current_thread_stats();
+
+	protected:
+		struct worker
+		{
+			explicit worker(std::string&& n)
+				: name(std::move(n))
+			{
+			}
+
+			const std::string	 name;
+			std::atomic<int64_t> os_id { 0 }; // set once the thread runs
+
+			std::mutex	 lock;
+			thread_stats last; // written by the worker on exit
+		};
+
+		static void _begin_worker(worker& w);
+		static void _end_worker(worker& w);
+
 	protected:
-		std::vector<std::thread> m_thread_handles;
+		std::vector<std::thread>			 m_thread_handles;
+		std::vector<std::unique_ptr<worker>> m_workers; // same index as m_thread_handles
 	};
 
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "threading_config.h"
+#include "trace.h"
 
 #include <thread>
 #include <atomic>
@@ -10,37 +11,256 @@
 namespace threading
 {
 
+	// minimum distance between data written by different threads to avoid false sharing
+	// std::hardware_destructive_interference_size is not used, its value changes with -mtune and is not ABI stable
+#if defined(__APPLE__) && defined(__aarch64__)
+	constexpr std::size_t hardware_destructive_interference_size = 128;
+#else
+	constexpr std::size_t hardware_destructive_interference_size = 64;
+#endif
+
+	// used to keep independently written data on separate cache lines
+	constexpr std::size_t cache_line_size = hardware_destructive_interference_size;
+
+	template <class T>
+	// T alone on its cache line, for a member written by other threads than its neighbours
+	struct alignas(hardware_destructive_interference_size) cache_padded
+	{
+	public:
+		template <class... A>
+		explicit cache_padded(A&&... args)
+			: value(std::forward<A>(args)...)
+		{
+		}
+
+	public:
+		inline T& operator*()
+		{
+			return value;
+		}
+		inline const T& operator*() const
+		{
+			return value;
+		}
+		inline T* operator->()
+		{
+			return &value;
+		}
+		inline const T* operator->() const
+		{
+			return &value;
+		}
+
+	public:
+		T value;
+	};
+
+	namespace detail
+	{
+#if defined(THREADING_PACKED_LAYOUT)
+		template <class T>
+		// cache_padded without the padding, the layout before the hot members were split
+		struct hot_cell
+		{
+		public:
+			template <class... A>
+			explicit hot_cell(A&&... args)
+				: value(std::forward<A>(args)...)
+			{
+			}
+
+		public:
+			inline T& operator*()
+			{
+				return value;
+			}
+			inline const T& operator*() const
+			{
+				return value;
+			}
+			inline T* operator->()
+			{
+				return &value;
+			}
+			inline const T* operator->() const
+			{
+				return &value;
+			}
+
+		public:
+			T value;
+		};
+#	define THREADING_CACHE_ALIGNED
+#else
+		// members the primitives keep on a line of their own, see THREADING_PACKED_LAYOUT
+		template <class T>
+		using hot_cell = cache_padded<T>;
+#	define THREADING_CACHE_ALIGNED alignas(threading::cache_line_size)
+#endif
+	}
+
 	//--------------------------------------------------------------------------------------------------------------------------------
 
-	struct spin_lock
+	// intrusive node for waiters that do not block a thread (coroutines, callbacks)
+	// the node is owned by the waiter, the primitive only links it and calls resume() once the wait is satisfied
+	struct async_waiter
 	{
-		using lock_guard = std::lock_guard<spin_lock>;
+		async_waiter* next = nullptr;
+		void (*resume)(async_waiter*) = nullptr;
+	};
+
+	// FIFO of async_waiter nodes, not thread safe, guarded by the owning primitive
+	struct async_waiter_list
+	{
+	public:
+		inline bool empty() const
+		{
+			return m_head == nullptr;
+		}
 
-		std::atomic<bool> flag = { false };
+		inline void push_back(async_waiter& w)
+		{
+			w.next = nullptr;
+			if (m_tail != nullptr)
+				m_tail->next = &w;
+			else
+				m_head = &w;
+			m_tail = &w;
+		}
 
-		inline void lock() noexcept
+		inline async_waiter* pop_front()
+		{
+			async_waiter* r = m_head;
+			if (r != nullptr)
+			{
+				m_head = r->next;
+				if (m_head == nullptr)
+					m_tail = nullptr;
+				r->next = nullptr;
+			}
+			return r;
+		}
+
+		inline async_waiter* take_all()
+		{
+			async_waiter* r = m_head;
+			m_head = nullptr;
+			m_tail = nullptr;
+			return r;
+		}
+
+		// call without holding the primitive lock, nodes can be destroyed as soon as they are resumed
+		inline static void resume_all(async_waiter* head)
 		{
+			while (head != nullptr)
+			{
+				async_waiter* next = head->next;
+				head->resume(head);
+				head = next;
+			}
+		}
+
+	protected:
+		async_waiter* m_head = nullptr;
+		async_waiter* m_tail = nullptr;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// pause instructions a lock waiter spends before it parks the thread, long enough to cover a short critical section
+	constexpr uint32_t lock_spin_count = 128;
+
+	namespace detail
+	{
+		// sleeps while word == expected, may return spuriously (futex on linux, std::atomic::wait with C++20, yield otherwise)
+		void park_word(const std::atomic<uint32_t>& word, const uint32_t expected) noexcept;
+		void unpark_word(std::atomic<uint32_t>& word, const bool all) noexcept;
+
+		// 32 bit side words for waits that cannot use the waited word itself (not 32 bit, or no room for a waiter mark),
+		// shared by all addresses hashing to the slot; a wake bumps the epoch and the waiters recheck their own condition
+		struct alignas(cache_line_size) parking_slot
+		{
+			std::atomic<uint32_t> epoch { 0 };
+			std::atomic<uint32_t> waiters { 0 };
+		};
+		parking_slot& parking_slot_for(const void* address) noexcept;
+
+		template <class F>
+		// sleeps while _waiting() returns true, until unpark_address(address); the word _waiting() reads is changed
+		// with seq_cst before unpark_address(), so the check and the waiter count cannot miss each other
+		inline void park_address(const void* address, const F& _waiting) noexcept
+		{
+			parking_slot& slot = parking_slot_for(address);
+			slot.waiters.fetch_add(1, std::memory_order_seq_cst);
 			while (true)
 			{
-				if (flag.exchange(true, std::memory_order_acquire) == false)
+				const uint32_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+				if (_waiting() == false)
 					break;
-
-				while (flag.load(std::memory_order_relaxed))
-				{
-					// threading_impl_spin_yield();
-				}
+				park_word(slot.epoch, epoch);
 			}
+			slot.waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		// a load when nobody waits on the slot
+		inline void unpark_address(const void* address) noexcept
+		{
+			parking_slot& slot = parking_slot_for(address);
+			if (slot.waiters.load(std::memory_order_seq_cst) == 0)
+				return;
+			slot.epoch.fetch_add(1, std::memory_order_release);
+			unpark_word(slot.epoch, true);
+		}
+
+		template <class T>
+		// a 32 bit word is its own futex, other sizes park on their parking_slot
+		inline void park(const std::atomic<T>& word, const T expected) noexcept
+		{
+			if constexpr (sizeof(T) == sizeof(uint32_t))
+				park_word(reinterpret_cast<const std::atomic<uint32_t>&>(word), static_cast<uint32_t>(expected));
+			else
+				park_address(&word, [&]() { return word.load(std::memory_order_seq_cst) == expected; });
+		}
+
+		template <class T>
+		inline void unpark_all(std::atomic<T>& word) noexcept
+		{
+			if constexpr (sizeof(T) == sizeof(uint32_t))
+				unpark_word(reinterpret_cast<std::atomic<uint32_t>&>(word), true);
+			else
+				unpark_address(&word);
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// spins for lock_spin_count pauses, then parks on the lock word; unlock() only makes a syscall when a waiter may be parked
+	struct spin_lock
+	{
+		using lock_guard = std::lock_guard<spin_lock>;
+
+		std::atomic<uint32_t> flag = { 0 }; // 0 free, 1 locked, 2 locked and waiters may be parked
+
+		inline void lock() noexcept
+		{
+			uint32_t expected = 0;
+			if (flag.compare_exchange_strong(expected, 1, std::memory_order_acquire) == false)
+				_lock_contended();
 		}
 
 		inline void unlock() noexcept
 		{
-			flag.store(false, std::memory_order_release);
+			if (flag.exchange(0, std::memory_order_release) == 2)
+				detail::unpark_word(flag, false);
 		}
 
 		inline lock_guard guard() noexcept
 		{
 			return lock_guard(*this);
 		}
+
+	protected:
+		void _lock_contended() noexcept;
 	};
 
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -64,6 +284,7 @@ namespace threading
 	//--------------------------------------------------------------------------------------------------------------------------------
 
 	template <class T>
+	// lock word that holds a value while unlocked, waiters spin for lock_spin_count pauses and then park on the word
 	struct spin_value_lock
 	{
 	public:
@@ -71,13 +292,17 @@ namespace threading
 
 		using value_t = T;
 
+		// max() is locked, max() - 2 is locked with waiters that may be parked, max() - 1 is the default value
+		static constexpr value_t locked_state = std::numeric_limits<value_t>::max();
+		static constexpr value_t parked_state = std::numeric_limits<value_t>::max() - 2;
+
 		inline static bool value_set(const value_t data_value)
 		{
-			return data_value != std::numeric_limits<value_t>::max();
+			return data_value != locked_state && data_value != parked_state;
 		}
 		inline static bool value_locked(const value_t data_value)
 		{
-			return data_value == std::numeric_limits<value_t>::max();
+			return data_value == locked_state || data_value == parked_state;
 		}
 		inline static bool value_default(const value_t data_value)
 		{
@@ -111,63 +336,69 @@ namespace threading
 
 		inline value_t lock() noexcept
 		{
-			while (true)
-			{
-				value_t data_value = data.exchange(std::numeric_limits<value_t>::max(), std::memory_order_acquire);
-				if (value_set(data_value))
-					return data_value;
-				do
-				{
-					// threading_impl_spin_yield();
-				} while (value_locked(data.load(std::memory_order_relaxed)));
-			}
+			value_t data_value = data.load(std::memory_order_relaxed);
+			if (value_set(data_value) && data.compare_exchange_strong(data_value, locked_state, std::memory_order_acquire))
+				return data_value;
+			return _lock_contended();
 		}
 
 		template <class F>
 		// bool _func(value_t); will wait until _func() returns true, _func is called in in locked state;
+		// after lock_spin_count rejected values the caller parks until an unlock() stores another value, it must only depend on the value
 		inline value_t lock_if(const F& _func) noexcept
 		{
+			uint32_t spins = 0;
 			while (true)
 			{
-				value_t data_value = data.exchange(std::numeric_limits<value_t>::max(), std::memory_order_acquire);
-				if (value_locked(data_value))
-				{
-					do
-					{
-						// yield for hyperthreading improvements:
-						//__builtin_ia32_pause
-					} while (value_locked(data.load(std::memory_order_relaxed)));
-				}
-				else if (_func(data_value))
-				{
-					THREADING_ASSERT(value_set(data.load(std::memory_order_relaxed)));
+				value_t data_value = lock();
+				if (_func(data_value))
 					return data_value;
-				}
-				else
+				if (spins < lock_spin_count)
 				{
-					THREADING_ASSERT(value_set(data.load(std::memory_order_relaxed)));
-					data.store(data_value, std::memory_order_release);
+					spins++;
+					unlock(data_value);
+					threading_impl_spin_yield();
 				}
+				else
+					_park_rejected(data_value);
 			}
 		}
 
+		// returns locked_state when the lock is held by someone else
 		inline value_t trylock() noexcept
 		{
-			return data.exchange(std::numeric_limits<value_t>::max(), std::memory_order_acquire);
+			value_t data_value = data.load(std::memory_order_relaxed);
+			while (value_set(data_value))
+			{
+				if (data.compare_exchange_weak(data_value, locked_state, std::memory_order_acquire))
+					return data_value;
+			}
+			return locked_state;
 		}
 
 		inline void unlock(const value_t data_value) noexcept
 		{
-			data.store(data_value, std::memory_order_release);
+			_unlock_unchanged(data_value);
+			// lock_if() callers parked on a rejected value recheck the word, costs a load while there are none
+			detail::unpark_address(&data);
 		}
 
+		// waits until the lock is free and returns its value, without taking it
 		inline value_t peek() const noexcept
 		{
+			uint32_t spins = 0;
 			while (true)
 			{
 				value_t data_value = data.load(std::memory_order_relaxed);
 				if (value_set(data_value))
 					return data_value;
+				if (spins < lock_spin_count)
+				{
+					spins++;
+					threading_impl_spin_yield();
+				}
+				else if (_announce_parked(data_value))
+					detail::park(data, parked_state);
 			}
 		}
 
@@ -181,8 +412,62 @@ namespace threading
 			return lock_guard(*this);
 		}
 
+	protected:
+		value_t _lock_contended() noexcept
+		{
+			THREADING_TRACE_SCOPE("spin_value_lock wait");
+			value_t	 lock_value = locked_state;
+			uint32_t spins = 0;
+			while (true)
+			{
+				value_t data_value = data.load(std::memory_order_relaxed);
+				if (value_set(data_value))
+				{
+					if (data.compare_exchange_weak(data_value, lock_value, std::memory_order_acquire))
+						return data_value;
+				}
+				else if (spins < lock_spin_count)
+				{
+					spins++;
+					threading_impl_spin_yield();
+				}
+				else if (_announce_parked(data_value))
+				{
+					detail::park(data, parked_state);
+					lock_value = parked_state; // there may be more parked threads, our unlock() has to wake them
+				}
+			}
+		}
+
+		// wakes parked lockers only, for an unlock that puts back the value it found
+		inline void _unlock_unchanged(const value_t data_value) noexcept
+		{
+			THREADING_ASSERT(value_set(data_value));
+			// seq_cst orders the store before the parking_slot waiter loads of unpark_address()
+			if (data.exchange(data_value, std::memory_order_seq_cst) == parked_state)
+				detail::unpark_all(data);
+		}
+
+		// puts the rejected value back and parks while the word still holds it or is locked
+		// an unlocked word has no room for a waiter mark, so the waiter parks on the parking_slot of the word
+		void _park_rejected(const value_t rejected) noexcept
+		{
+			THREADING_TRACE_SCOPE("spin_value_lock wait value");
+			_unlock_unchanged(rejected); // other lock_if() callers rejected it as well, they keep sleeping
+			detail::park_address(&data, [&]() {
+				const value_t data_value = data.load(std::memory_order_seq_cst);
+				return data_value == rejected || value_locked(data_value);
+			});
+		}
+
+		// moves locked_state to parked_state, false when the lock changed meanwhile
+		inline bool _announce_parked(value_t data_value) const noexcept
+		{
+			return data_value == parked_state || data.compare_exchange_weak(data_value, parked_state, std::memory_order_relaxed);
+		}
+
 	public:
-		std::atomic<value_t> data = { std::numeric_limits<value_t>::max() - 1 };
+		mutable std::atomic<value_t> data = { std::numeric_limits<value_t>::max() - 1 }; // mutable: peek() marks parked waiters
 	};
 
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -204,13 +489,33 @@ namespace threading
 		{
 			std::unique_lock<std::mutex> lk(m_lock);
 			if (m_available == 0)
-				m_cv.wait(lk, [this] { return m_available == 0; });
+				m_cv.wait(lk, [this] { return m_available != 0; });
 			m_available--;
 		}
 
+		// returns true when acquired immediately, otherwise w is queued and resumed once a release() hands it the count
+		inline bool acquire_async(async_waiter& w)
+		{
+			std::unique_lock<std::mutex> lk(m_lock);
+			if (m_available != 0)
+			{
+				m_available--;
+				return true;
+			}
+			m_async_waiters.push_back(w);
+			return false;
+		}
+
 		inline void release()
 		{
 			std::unique_lock<std::mutex> lock(m_lock);
+			async_waiter*				 w = m_async_waiters.pop_front();
+			if (w != nullptr)
+			{
+				lock.unlock();
+				w->resume(w);
+				return;
+			}
 			m_available++;
 			m_cv.notify_one();
 		}
@@ -219,6 +524,92 @@ namespace threading
 		std::mutex				m_lock;
 		std::condition_variable m_cv;
 		std::size_t				m_available;
+		async_waiter_list		m_async_waiters;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// lets a thread sleep until a condition on a lock-free structure holds, without a lock around the structure:
+	//	auto key = ec.prepare_wait();
+	//	if (condition()) ec.cancel_wait(); else ec.commit_wait(key);
+	// the side that makes the condition true calls notify_one()/notify_all() afterwards, which is a fence and one load when nobody waits
+	// a key from prepare_wait() is only woken by notifications issued after that call, so no wakeup is lost in between
+	struct event_count
+	{
+	public:
+		using key_t = uint32_t;
+
+	public:
+		event_count(const event_count&) = delete;
+		event_count& operator=(const event_count&) = delete;
+
+	public:
+		event_count() = default;
+
+	public:
+		inline key_t prepare_wait() noexcept
+		{
+			return key_t(m_state.fetch_add(waiter_one, std::memory_order_seq_cst) >> epoch_shift);
+		}
+
+		inline void cancel_wait() noexcept
+		{
+			m_state.fetch_sub(waiter_one, std::memory_order_seq_cst);
+		}
+
+		// blocks until a notification after prepare_wait(), the caller checks its condition again
+		inline void commit_wait(const key_t key)
+		{
+			{
+				std::unique_lock<std::mutex> lk(m_lock);
+				while (_epoch() == key)
+					m_cv.wait(lk);
+			}
+			m_state.fetch_sub(waiter_one, std::memory_order_seq_cst);
+		}
+
+		inline void notify_one()
+		{
+			if (_bump())
+				m_cv.notify_one();
+		}
+
+		inline void notify_all()
+		{
+			if (_bump())
+				m_cv.notify_all();
+		}
+
+	protected:
+		static constexpr uint32_t epoch_shift = 32;
+		static constexpr uint64_t waiter_one = 1;
+		static constexpr uint64_t waiter_mask = (uint64_t(1) << epoch_shift) - 1;
+		static constexpr uint64_t epoch_one = uint64_t(1) << epoch_shift;
+
+		inline key_t _epoch() const noexcept
+		{
+			return key_t(m_state.load(std::memory_order_acquire) >> epoch_shift);
+		}
+
+		// returns true when there are waiters to wake
+		inline bool _bump()
+		{
+			// pairs with prepare_wait(): either the waiter sees the new condition or we see the waiter
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if ((m_state.load(std::memory_order_relaxed) & waiter_mask) == 0)
+				return false;
+			m_state.fetch_add(epoch_one, std::memory_order_acq_rel);
+			{
+				// a waiter either sleeps already or still has to check the epoch under the lock
+				std::lock_guard<std::mutex> _(m_lock);
+			}
+			return true;
+		}
+
+	protected:
+		std::atomic<uint64_t>	m_state { 0 }; // epoch << 32 | waiters
+		std::mutex				m_lock;
+		std::condition_variable m_cv;
 	};
 
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -243,17 +634,22 @@ namespace threading
 		// all thread are blocked here until the number of threads waiting is equal with group size
 		// does not reset anything
 
+		// arrives without blocking; returns true when the group is complete, otherwise w is resumed when it completes
+		bool arrive_async(async_waiter& w);
+
 		inline uint_fast32_t group_size() const
 		{
 			return m_group_size;
 		}
 
 	protected:
-		std::atomic<uint_fast32_t> m_entered_count { 0 };
-		std::mutex				   m_lock;
-		std::condition_variable	   m_cv;
-		uint_fast32_t			   m_count = 0;
-		uint_fast32_t			   m_group_size = 0;
+		detail::hot_cell<std::atomic<uint_fast32_t>> m_entered_count { 0 }; // every arrival, and the destructor spins on it
+
+		std::mutex				m_lock;
+		std::condition_variable m_cv;
+		uint_fast32_t			m_count = 0;
+		uint_fast32_t			m_group_size = 0;
+		async_waiter_list		m_async_waiters;
 	};
 
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -278,9 +674,10 @@ namespace threading
 		void reset_group_size(const uint32_t group_size);
 
 	protected:
+		detail::hot_cell<std::atomic<uint32_t>> m_generation { 0 }; // threads leaving the barrier spin on it
+
 		std::mutex				m_lock;
 		std::condition_variable m_cv;
-		std::atomic<uint32_t>	m_generation { 0 };
 		uint32_t				m_count = 0;
 		uint32_t				m_group_size = 0;
 	};
@@ -320,7 +717,8 @@ namespace threading
 		}
 
 	protected:
-		std::atomic<uint32_t>	m_entered_count { 0 };
+		detail::hot_cell<std::atomic<uint32_t>> m_entered_count { 0 };
+
 		std::mutex				m_lock;
 		std::condition_variable m_cv_wait;
 		std::condition_variable m_cv_lock;
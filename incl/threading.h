@@ -4,7 +4,23 @@
 
 #include "thread_primitives.h"
 #include "thread_group.h"
+#include "unique_task.h"
 #include "async_pipe.h"
 #include "latch_pool.h"
+#include "worker_pool.h"
+#include "task_graph.h"
+#include "parallel_algorithms.h"
+#include "coro_task.h"
+#include "future.h"
+#include "timer_wheel.h"
+#include "object_pool.h"
+#include "pooled_async_pipe.h"
+#include "spsc_queue.h"
+#include "pipeline.h"
+#include "striped_counter.h"
+#include "lock_table.h"
+#include "concurrent_hash_map.h"
+#include "elastic_consumers.h"
+#include "perf_counters.h"
 
 
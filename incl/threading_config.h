@@ -5,6 +5,10 @@
 
 #define THREADING_ENABLE_ASSERT
 
+// #define THREADING_TRACE // records thread activity into per-thread rings, see trace.h
+
+// #define THREADING_PACKED_LAYOUT // no cache line padding inside latch, barrier and async_pipe, to benchmark what it buys
+
 //--------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------------------------------------------------
 #if defined(THREADING_TESTING)
@@ -40,6 +44,17 @@
 
 //--------------------------------------------------------------------------------------------------------------------------------
 
+//--------------------------------------------------------------------------------------------------------------------------------
+// C++20 coroutine support (task<T>, awaitable async_pipe/latch/semaphore)
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#	if __has_include(<coroutine>)
+#		define THREADING_COROUTINES
+#	endif
+#endif
+
+//--------------------------------------------------------------------------------------------------------------------------------
+
 #include <devtiny.h>
 #include <thread>
 
@@ -58,6 +73,17 @@
 			{                               \
 			} while (false)
 #	endif
+#elif defined(__GNUC__) || defined(__clang__)
+#	if defined(__x86_64__) || defined(__i386__)
+#		define threading_impl_spin_yield() __builtin_ia32_pause()
+#	elif defined(__aarch64__) || defined(__arm__)
+#		define threading_impl_spin_yield() __asm__ __volatile__("yield")
+#	else
+#		define threading_impl_spin_yield() \
+			do                              \
+			{                               \
+			} while (false)
+#	endif
 #endif
 
 //--------------------------------------------------------------------------------------------------------------------------------
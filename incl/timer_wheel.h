@@ -0,0 +1,105 @@
+#pragma once
+
+#include "async_pipe.h"
+#include "worker_pool.h"
+
+#include <chrono>
+#include <deque>
+
+namespace threading
+{
+
+	// hierarchical timing wheel (4 levels of 256 slots) driven by one timer thread
+	// insert and cancel are O(1), timers are pooled nodes linked into the wheel slots, no thread or heap entry per timer
+	// callbacks run on the timer thread, use the post_* helpers to dispatch into an async_pipe or a worker_pool
+	struct timer_wheel
+	{
+	public:
+		using callback_t = unique_task;
+		using timer_id = uint64_t; // 0 is never a valid id
+
+		static constexpr uint32_t level_bits = 8;
+		static constexpr uint32_t level_slots = 1 << level_bits;
+		static constexpr uint32_t level_count = 4;
+
+	public:
+		timer_wheel(const timer_wheel&) = delete;
+		timer_wheel& operator=(const timer_wheel&) = delete;
+
+	public:
+		explicit timer_wheel(const uint32_t tick_ms = 1);
+		~timer_wheel(); // pending timers are dropped
+
+	public:
+		timer_id schedule_after(const uint32_t delay_ms, callback_t&& _func);
+		timer_id schedule_every(const uint32_t period_ms, callback_t&& _func);
+
+		// returns false if the timer already fired (one shot) or was cancelled
+		// a callback running while cancel() is called still completes
+		bool cancel(const timer_id id);
+
+		std::size_t size(); // active timers
+
+	public:
+		template <class T, class S>
+		inline timer_id post_after(const uint32_t delay_ms, async_pipe<T, S>& pipe, T&& item)
+		{
+			return schedule_after(delay_ms, [&pipe, item = std::move(item)]() mutable { pipe.push_back(std::move(item)); });
+		}
+		inline timer_id post_after(const uint32_t delay_ms, worker_pool& pool, callback_t&& _func)
+		{
+			return schedule_after(delay_ms, [&pool, f = std::move(_func)]() mutable { pool.submit(std::move(f)); });
+		}
+		inline timer_id post_every(const uint32_t period_ms, worker_pool& pool, callback_t&& _func)
+		{
+			// a submitted run may still be executing when the timer is cancelled
+			auto f = std::make_shared<callback_t>(std::move(_func));
+			return schedule_every(period_ms, [&pool, f]() { pool.submit([f]() { (*f)(); }); });
+		}
+
+	protected:
+		static constexpr uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+		struct timer_node
+		{
+			callback_t callback;
+			uint64_t   expires = 0;
+			uint32_t   period = 0; // ticks, 0 for one shot
+			uint32_t   generation = 1;
+			uint32_t   next = invalid_index;
+			uint32_t   prev = invalid_index;
+			uint16_t   slot = 0;
+			uint8_t	   level = 0;
+			bool	   active = false; // linked into the wheel or firing
+			bool	   firing = false;
+		};
+
+	protected:
+		timer_id _schedule(const uint32_t delay_ms, const uint32_t period_ms, callback_t&& _func);
+		uint32_t _to_ticks(const uint32_t ms) const;
+		uint64_t _now_tick() const;
+
+		void _link(const uint32_t index);
+		void _unlink(const uint32_t index);
+		void _free(const uint32_t index);
+		void _cascade(const uint32_t level, const uint32_t slot);
+		void _advance(const uint64_t target_tick, std::vector<uint32_t>& expired);
+		void _timer_loop();
+
+	protected:
+		const uint32_t						  m_tick_ms;
+		const std::chrono::steady_clock::time_point m_start;
+
+		std::mutex				m_lock;
+		std::condition_variable m_wake;
+		std::deque<timer_node>	m_nodes; // stable addresses, callbacks run outside the lock
+		uint32_t				m_free_head = invalid_index;
+		uint32_t				m_wheel[level_count][level_slots];
+		uint64_t				m_current_tick = 0;
+		std::size_t				m_active = 0;
+		bool					m_stop = false;
+
+		thread_group m_thread;
+	};
+
+}
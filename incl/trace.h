@@ -0,0 +1,155 @@
+#pragma once
+
+#include "threading_config.h"
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// timeline of what threads do, dumped as chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)
+// only built with THREADING_TRACE defined, otherwise the macros expand to nothing and dump() writes an empty trace
+//	THREADING_TRACE_SCOPE("parse"); // span until the end of the scope
+//	THREADING_TRACE_INSTANT("flush");
+// every thread writes into a ring of its own (the oldest events are overwritten), so recording takes no lock
+// a scope records a begin and an end event, each one timestamp; the ring of an exited thread goes to the next new thread
+// names must be string literals or otherwise outlive the dump
+
+namespace threading
+{
+	namespace trace
+	{
+		// writes every ring as one JSON document; threads may keep recording, events overwritten meanwhile can come out garbled
+		void dump(std::ostream& out);
+		bool dump_file(const char* path);
+		// forgets recorded events of all threads, not meant to run while threads record
+		void clear();
+		// shown as the thread name in the viewer, copied
+		void set_thread_name(const char* name);
+	}
+}
+
+#if defined(THREADING_TRACE)
+
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	elif defined(__x86_64__) || defined(__i386__)
+#		include <x86intrin.h>
+#	endif
+#	include <chrono>
+
+#	ifndef THREADING_TRACE_RING_SIZE
+#		define THREADING_TRACE_RING_SIZE 8192 // events per thread, a power of two
+#	endif
+
+namespace threading
+{
+	namespace trace
+	{
+		namespace detail
+		{
+			// event kind in the top bits of the timestamp, ticks need decades to reach them
+			constexpr uint64_t kind_shift = 62;
+			constexpr uint64_t ticks_mask = (uint64_t(1) << kind_shift) - 1;
+			enum class kind : uint64_t
+			{
+				instant = 0,
+				begin = 1,
+				end = 2
+			};
+
+			// relaxed atomics: dump() reads rings that are still written
+			struct event
+			{
+				std::atomic<const char*> name { nullptr };
+				std::atomic<uint64_t>	 stamp { 0 }; // ticks | kind << kind_shift
+			};
+
+			struct ring
+			{
+				static constexpr uint64_t capacity = THREADING_TRACE_RING_SIZE;
+				static_assert((capacity & (capacity - 1)) == 0, "THREADING_TRACE_RING_SIZE must be a power of two");
+
+				std::atomic<uint64_t> head { 0 }; // events ever written
+				uint32_t			  tid = 0;
+				event				  events[capacity];
+			};
+
+			ring* register_thread(); // rings stay alive after their thread exits, and are reused by a later thread
+
+			inline thread_local ring* t_ring = nullptr; // constant initialized, no guard on access
+
+			inline ring* local_ring()
+			{
+				ring* r = t_ring;
+				if (r == nullptr)
+					r = t_ring = register_thread();
+				return r;
+			}
+
+			// ticks, converted when dumping
+			inline uint64_t now()
+			{
+#	if defined(_MSC_VER) && (defined(_M_AMD64) || defined(_M_IX86))
+				return __rdtsc();
+#	elif defined(__x86_64__) || defined(__i386__)
+				return __rdtsc();
+#	else
+				return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#	endif
+			}
+
+			inline void record(const char* name, const kind k)
+			{
+				ring*		   r = local_ring();
+				const uint64_t h = r->head.load(std::memory_order_relaxed);
+				event&		   e = r->events[h & (ring::capacity - 1)];
+				e.name.store(name, std::memory_order_relaxed);
+				e.stamp.store((now() & ticks_mask) | (uint64_t(k) << kind_shift), std::memory_order_relaxed);
+				r->head.store(h + 1, std::memory_order_release);
+			}
+		}
+
+		// records a begin event at construction and an end event at destruction
+		struct scope
+		{
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+
+			explicit scope(const char* name)
+				: m_name(name)
+			{
+				detail::record(name, detail::kind::begin);
+			}
+			~scope()
+			{
+				detail::record(m_name, detail::kind::end);
+			}
+
+		protected:
+			const char* m_name;
+		};
+
+		inline void instant(const char* name)
+		{
+			detail::record(name, detail::kind::instant);
+		}
+	}
+}
+
+#	define THREADING_TRACE_CONCAT_IMPL(a, b) a##b
+#	define THREADING_TRACE_CONCAT(a, b) THREADING_TRACE_CONCAT_IMPL(a, b)
+#	define THREADING_TRACE_SCOPE(name) threading::trace::scope THREADING_TRACE_CONCAT(_threading_trace_, __LINE__)(name)
+#	define THREADING_TRACE_INSTANT(name) threading::trace::instant(name)
+
+#else
+
+#	define THREADING_TRACE_SCOPE(name) \
+		do                              \
+		{                               \
+		} while (false)
+#	define THREADING_TRACE_INSTANT(name) \
+		do                                \
+		{                                 \
+		} while (false)
+
+#endif
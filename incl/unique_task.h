@@ -0,0 +1,182 @@
+#pragma once
+
+#include "object_pool.h"
+
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace threading
+{
+
+	namespace detail
+	{
+		// size classes for callables that do not fit inline, keeps the number of block pools small
+		constexpr std::size_t task_block_size(const std::size_t size)
+		{
+			std::size_t r = 64;
+			while (r < size)
+				r *= 2;
+			return r;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	template <std::size_t INLINE_SIZE>
+	// move-only void() callable
+	// callables up to INLINE_SIZE bytes that are nothrow movable are stored inline, larger ones in a block from a process wide block_pool
+	// trivially copyable callables (and out-of-line ones) are relocated with memcpy, no indirect call on move
+	struct basic_unique_task
+	{
+	public:
+		static_assert(INLINE_SIZE >= sizeof(void*), "the inline buffer holds the pointer to out-of-line callables");
+
+		static constexpr std::size_t inline_size = INLINE_SIZE;
+
+		template <class F>
+		static constexpr bool stored_inline = sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) &&
+											  std::is_nothrow_move_constructible<F>::value;
+
+	public:
+		basic_unique_task(const basic_unique_task&) = delete;
+		basic_unique_task& operator=(const basic_unique_task&) = delete;
+
+	public:
+		basic_unique_task() = default;
+		basic_unique_task(std::nullptr_t)
+		{
+		}
+		template <class F, class = typename std::enable_if<std::is_same<typename std::decay<F>::type, basic_unique_task>::value == false>::type>
+		basic_unique_task(F&& _func)
+		{
+			using func_t = typename std::decay<F>::type;
+			if constexpr (stored_inline<func_t>)
+			{
+				new (m_storage) func_t(std::forward<F>(_func));
+			}
+			else
+			{
+				static_assert(alignof(func_t) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned callables are not supported");
+				void* block = detail::block_pool<detail::task_block_size(sizeof(func_t))>::alloc();
+				func_t* f = new (block) func_t(std::forward<F>(_func));
+				std::memcpy(m_storage, &f, sizeof(f));
+			}
+			m_ops = &ops_for<func_t>::table;
+		}
+		basic_unique_task(basic_unique_task&& other) noexcept
+		{
+			_take(other);
+		}
+		basic_unique_task& operator=(basic_unique_task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				_take(other);
+			}
+			return *this;
+		}
+		basic_unique_task& operator=(std::nullptr_t)
+		{
+			reset();
+			return *this;
+		}
+		~basic_unique_task()
+		{
+			reset();
+		}
+
+	public:
+		inline void operator()()
+		{
+			THREADING_ASSERT(m_ops != nullptr);
+			m_ops->invoke(m_storage);
+		}
+		inline explicit operator bool() const
+		{
+			return m_ops != nullptr;
+		}
+		inline void reset()
+		{
+			if (m_ops == nullptr)
+				return;
+			if (m_ops->destroy != nullptr)
+				m_ops->destroy(m_storage);
+			m_ops = nullptr;
+		}
+
+	protected:
+		struct ops
+		{
+			void (*invoke)(void* storage);
+			void (*relocate)(void* dst, void* src); // nullptr: memcpy
+			void (*destroy)(void* storage); // nullptr: nothing to do
+		};
+
+		template <class F, bool INLINE = stored_inline<F>>
+		struct ops_for
+		{
+			static void invoke(void* storage)
+			{
+				(*std::launder(static_cast<F*>(storage)))();
+			}
+			static void relocate(void* dst, void* src)
+			{
+				F* f = std::launder(static_cast<F*>(src));
+				new (dst) F(std::move(*f));
+				f->~F();
+			}
+			static void destroy(void* storage)
+			{
+				std::launder(static_cast<F*>(storage))->~F();
+			}
+
+			static constexpr ops table = { &invoke, std::is_trivially_copyable<F>::value ? nullptr : &relocate,
+				std::is_trivially_destructible<F>::value ? nullptr : &destroy };
+		};
+		template <class F>
+		struct ops_for<F, false>
+		{
+			static F* get(void* storage)
+			{
+				F* f;
+				std::memcpy(&f, storage, sizeof(f));
+				return f;
+			}
+			static void invoke(void* storage)
+			{
+				(*get(storage))();
+			}
+			static void destroy(void* storage)
+			{
+				F* f = get(storage);
+				f->~F();
+				detail::block_pool<detail::task_block_size(sizeof(F))>::free(f);
+			}
+
+			static constexpr ops table = { &invoke, nullptr, &destroy };
+		};
+
+		inline void _take(basic_unique_task& other)
+		{
+			m_ops = other.m_ops;
+			if (m_ops == nullptr)
+				return;
+			if (m_ops->relocate != nullptr)
+				m_ops->relocate(m_storage, other.m_storage);
+			else
+				std::memcpy(m_storage, other.m_storage, INLINE_SIZE);
+			other.m_ops = nullptr;
+		}
+
+	protected:
+		alignas(std::max_align_t) unsigned char m_storage[INLINE_SIZE];
+		const ops* m_ops = nullptr;
+	};
+
+	// one cache line
+	using unique_task = basic_unique_task<cache_line_size - sizeof(void*)>;
+
+}
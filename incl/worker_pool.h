@@ -0,0 +1,133 @@
+#pragma once
+
+#include "thread_group.h"
+#include "unique_task.h"
+
+#include <deque>
+#include <memory>
+
+namespace threading
+{
+
+	// counts outstanding tasks of a fork/join region, see worker_pool::wait()
+	struct join_counter
+	{
+	public:
+		join_counter(const join_counter&) = delete;
+		join_counter& operator=(const join_counter&) = delete;
+
+	public:
+		join_counter() = default;
+		explicit join_counter(const std::size_t count)
+			: m_pending(count)
+		{
+		}
+
+	public:
+		inline void add(const std::size_t count)
+		{
+			m_pending.fetch_add(count, std::memory_order_relaxed);
+		}
+
+		inline void done()
+		{
+			std::size_t expected = m_pending.load(std::memory_order_relaxed);
+			while (expected > 1)
+			{
+				if (m_pending.compare_exchange_weak(expected, expected - 1, std::memory_order_acq_rel))
+					return;
+			}
+			// last one, the waiter may destroy the counter as soon as the lock is released
+			std::unique_lock<std::mutex> lk(m_lock);
+			m_pending.fetch_sub(1, std::memory_order_release);
+			m_cv.notify_all();
+		}
+
+		inline bool finished() const
+		{
+			return m_pending.load(std::memory_order_acquire) == 0;
+		}
+
+		// blocks the calling thread until the counter reaches zero
+		inline void wait()
+		{
+			std::unique_lock<std::mutex> lk(m_lock);
+			m_cv.wait(lk, [this]() { return finished(); });
+		}
+
+	protected:
+		friend struct worker_pool;
+
+		std::atomic<std::size_t> m_pending { 0 };
+		std::mutex				 m_lock;
+		std::condition_variable	 m_cv;
+	};
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	// fixed set of worker threads executing submitted tasks
+	// every worker owns a local LIFO queue, tasks submitted from a worker stay on that worker unless an idle worker steals them
+	// tasks submitted from other threads go through a shared queue
+	struct worker_pool
+	{
+	public:
+		using task_t = unique_task;
+
+	public:
+		worker_pool(const worker_pool&) = delete;
+		worker_pool& operator=(const worker_pool&) = delete;
+
+	public:
+		explicit worker_pool(const std::size_t worker_count);
+		~worker_pool(); // runs all remaining tasks, then joins workers
+
+	public:
+		void submit(task_t&& task);
+		// when called from a worker of this pool the task goes to the local queue of the calling worker, otherwise same as submit()
+		void submit_local(task_t&& task);
+
+		// blocks until counter reaches zero; workers of this pool execute pending tasks while waiting
+		void wait(join_counter& counter);
+
+		// runs one pending task on the calling thread; returns false if there was nothing to run
+		bool try_run_one();
+
+		// true when the calling thread is not a worker of this pool or its local queue is empty
+		bool local_queue_empty();
+
+		inline std::size_t size() const
+		{
+			return m_worker_count;
+		}
+
+	public:
+		static worker_pool* current(); // pool of the calling thread, nullptr if not a worker
+		static std::size_t	current_index(); // index of the calling worker, only valid when current() != nullptr
+
+	protected:
+		struct alignas(cache_line_size) worker_queue
+		{
+			threading::spin_lock lock;
+			std::deque<task_t>	 tasks;
+		};
+
+	protected:
+		void _worker_loop(const std::size_t index);
+		bool _pop_task(const std::size_t index, task_t& out);
+		bool _steal_task(const std::size_t index, task_t& out);
+		void _push(worker_queue& q, task_t&& task);
+
+	protected:
+		std::size_t					   m_worker_count;
+		std::unique_ptr<worker_queue[]> m_queues; // [m_worker_count] is the shared queue
+
+		alignas(cache_line_size) std::atomic<std::size_t> m_queued { 0 };
+		std::atomic<uint32_t>							   m_sleeping { 0 };
+		std::mutex										   m_sleep_lock;
+		std::condition_variable							   m_sleep_trigger;
+		bool											   m_stop = false;
+
+		thread_group m_threads; // destroyed first, joins workers
+	};
+
+}
@@ -6,36 +6,81 @@ namespace threading
 
 	bool locked_wait::awake_one(std::mutex& parent_mutex)
 	{
-		if (m_await_counter > 0)
-		{
-			std::unique_lock<std::mutex> lk(parent_mutex);
-			m_sleep_trigger.notify_one();
-			return true;
-		}
-		return false;
+		sleeper* s = m_sleepers;
+		if (s == nullptr)
+			return false;
+		m_sleepers = s->next;
+
+		std::unique_lock<std::mutex> lk(parent_mutex);
+		s->signaled = true;
+		s->trigger.notify_one();
+		return true;
 	}
 	uint32_t locked_wait::awake_all(std::mutex& sleep_mutex)
 	{
-		if (m_await_counter > 0)
+		sleeper* s = m_sleepers;
+		if (s == nullptr)
+			return 0;
+		m_sleepers = nullptr;
+
+		uint32_t					 r = 0;
+		std::unique_lock<std::mutex> lk(sleep_mutex);
+		for (; s != nullptr; r++)
 		{
-			auto						 r = m_await_counter;
-			std::unique_lock<std::mutex> lk(sleep_mutex);
-			m_sleep_trigger.notify_all();
-			return uint32_t(r);
+			sleeper* next = s->next; // s may be gone once signaled and the lock is released, not before
+			s->signaled = true;
+			s->trigger.notify_one();
+			s = next;
 		}
-		return 0;
+		return r;
 	}
 
 	void locked_wait::wait(threading::spin_lock& root_mutex, std::mutex& wait_mutex)
 	{
+		sleeper self;
+		self.next = m_sleepers;
+		m_sleepers = &self;
 		m_await_counter++;
 		{
 			std::unique_lock<std::mutex> lk(wait_mutex);
 			root_mutex.unlock();
-			m_sleep_trigger.wait(lk);
+			while (self.signaled == false)
+				self.trigger.wait(lk);
 		}
 		root_mutex.lock();
 		m_await_counter--;
 	}
 
+	bool locked_wait::wait_for(threading::spin_lock& root_mutex, std::mutex& wait_mutex, const std::chrono::nanoseconds timeout)
+	{
+		sleeper self;
+		self.next = m_sleepers;
+		m_sleepers = &self;
+		m_await_counter++;
+		bool woken;
+		{
+			std::unique_lock<std::mutex> lk(wait_mutex);
+			root_mutex.unlock();
+			woken = self.trigger.wait_for(lk, timeout, [&self]() { return self.signaled; });
+		}
+		root_mutex.lock();
+		if (woken == false)
+		{
+			// an awake_*() between the timeout and root_mutex.lock() already took us off the stack
+			woken = self.signaled;
+			if (woken == false)
+				_unlink(&self);
+		}
+		m_await_counter--;
+		return woken;
+	}
+
+	void locked_wait::_unlink(sleeper* s)
+	{
+		sleeper** link = &m_sleepers;
+		while (*link != s)
+			link = &(*link)->next;
+		*link = s->next;
+	}
+
 }
@@ -0,0 +1,260 @@
+
+#include "../incl/object_pool.h"
+
+#include <algorithm>
+#include <new>
+
+namespace threading
+{
+
+	namespace
+	{
+		// ids of live pools; thread exit only touches caches of pools that are still alive
+		struct pool_registry
+		{
+			std::mutex			  lock;
+			std::vector<uint64_t> alive;
+			uint64_t			  next_id = 1;
+		};
+
+		pool_registry& registry()
+		{
+			static pool_registry* r = new pool_registry(); // outlives thread_local destructors at exit
+			return *r;
+		}
+
+		thread_local bool t_caches_released = false; // trivial, still readable after thread_caches is destroyed
+	}
+
+	struct detail::thread_caches
+	{
+		struct entry
+		{
+			uint64_t			id;
+			detail::pool_cache* cache;
+		};
+
+		std::vector<entry> entries;
+
+		~thread_caches()
+		{
+			// later frees on this thread must not reach the caches another thread may claim from now on
+			t_caches_released = true;
+			object_pool_base::thread_cache_ref& ref = object_pool_base::_last_used();
+			ref.id = 0;
+			ref.cache = nullptr;
+
+			pool_registry&				r = registry();
+			std::lock_guard<std::mutex> _(r.lock);
+			for (const entry& e : entries)
+			{
+				if (std::find(r.alive.begin(), r.alive.end(), e.id) == r.alive.end())
+					continue;
+				e.cache->flush_batch();
+				e.cache->m_claimed.store(false, std::memory_order_release);
+			}
+		}
+	};
+
+	namespace
+	{
+		detail::thread_caches& local_caches()
+		{
+			static thread_local detail::thread_caches c;
+			return c;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	object_pool_base::object_pool_base(const std::size_t node_size, const std::size_t node_align, const std::size_t slab_nodes)
+		: m_node_size(node_size)
+		, m_node_align(std::max(node_align, cache_line_size))
+		, m_slab_nodes(slab_nodes > 0 ? slab_nodes : 1)
+		, m_id([]() {
+			pool_registry&				r = registry();
+			std::lock_guard<std::mutex> _(r.lock);
+			uint64_t					id = r.next_id++;
+			r.alive.push_back(id);
+			return id;
+		}())
+	{
+	}
+
+	object_pool_base::~object_pool_base()
+	{
+		{
+			pool_registry&				r = registry();
+			std::lock_guard<std::mutex> _(r.lock);
+			r.alive.erase(std::find(r.alive.begin(), r.alive.end(), m_id));
+		}
+		for (void* slab : m_slabs)
+			::operator delete(slab, std::align_val_t(m_node_align));
+	}
+
+	void object_pool_base::flush()
+	{
+		if (detail::pool_cache* c = _local_cache())
+			c->flush_batch();
+	}
+
+	std::size_t object_pool_base::slab_count()
+	{
+		std::lock_guard<std::mutex> _(m_lock);
+		return m_slabs.size();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	object_pool_base::thread_cache_ref& object_pool_base::_last_used()
+	{
+		static thread_local thread_cache_ref ref;
+		return ref;
+	}
+
+	detail::pool_cache* object_pool_base::_find_cache()
+	{
+		if (t_caches_released)
+			return nullptr;
+		detail::thread_caches& local = local_caches();
+
+		detail::pool_cache* c = nullptr;
+		for (const auto& e : local.entries)
+		{
+			if (e.id == m_id)
+			{
+				c = e.cache;
+				break;
+			}
+		}
+
+		if (c == nullptr)
+		{
+			c = _claim_cache();
+
+			// drop entries of destroyed pools so the list stays short
+			{
+				pool_registry&				r = registry();
+				std::lock_guard<std::mutex> _(r.lock);
+				local.entries.erase(std::remove_if(local.entries.begin(), local.entries.end(),
+									  [&](const detail::thread_caches::entry& e) {
+										  return std::find(r.alive.begin(), r.alive.end(), e.id) == r.alive.end();
+									  }),
+					local.entries.end());
+			}
+			local.entries.push_back({ m_id, c });
+		}
+
+		thread_cache_ref& ref = _last_used();
+		ref.id = m_id;
+		ref.cache = c;
+		return c;
+	}
+
+	detail::pool_cache* object_pool_base::_claim_cache()
+	{
+		std::lock_guard<std::mutex> _(m_lock);
+		for (auto& owned : m_caches)
+		{
+			bool expected = false;
+			if (owned->m_claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+				return owned.get(); // left behind by a thread that exited
+		}
+		m_caches.push_back(std::make_unique<detail::pool_cache>());
+		detail::pool_cache* c = m_caches.back().get();
+		c->m_claimed.store(true, std::memory_order_relaxed);
+		return c;
+	}
+
+	detail::pool_node* object_pool_base::_alloc_slow(detail::pool_cache* c)
+	{
+		const bool released = c == nullptr;
+		if (released)
+			c = _claim_cache(); // borrowed for this one allocation
+
+		detail::pool_node* n = c->m_free;
+		if (n == nullptr)
+			n = _refill(c);
+		c->m_free = n->next;
+
+		if (released)
+		{
+			c->flush_batch();
+			c->m_claimed.store(false, std::memory_order_release);
+		}
+		return n;
+	}
+
+	detail::pool_node* object_pool_base::_refill(detail::pool_cache* c)
+	{
+		c->flush_batch();
+
+		detail::pool_node* n = c->m_remote.exchange(nullptr, std::memory_order_acquire);
+		if (n != nullptr)
+			return n;
+
+		char* slab = static_cast<char*>(::operator new(m_node_size * m_slab_nodes, std::align_val_t(m_node_align)));
+		{
+			std::lock_guard<std::mutex> _(m_lock);
+			m_slabs.push_back(slab);
+		}
+
+		detail::pool_node* head = nullptr;
+		for (std::size_t i = m_slab_nodes; i > 0; i--)
+		{
+			auto* node = reinterpret_cast<detail::pool_node*>(slab + (i - 1) * m_node_size);
+			node->owner = c;
+			node->next = head;
+			head = node;
+		}
+		return head;
+	}
+
+	void object_pool_base::_free_remote(detail::pool_cache* c, detail::pool_node* n)
+	{
+		if (c == nullptr)
+		{
+			// the caches of this thread are released, the node goes back alone
+			std::atomic<detail::pool_node*>& remote = n->owner->m_remote;
+			detail::pool_node*				 head = remote.load(std::memory_order_relaxed);
+			do
+			{
+				n->next = head;
+			} while (remote.compare_exchange_weak(head, n, std::memory_order_release, std::memory_order_relaxed) == false);
+			return;
+		}
+
+		if (c->m_batch_owner != n->owner)
+		{
+			c->flush_batch();
+			c->m_batch_owner = n->owner;
+		}
+
+		n->next = c->m_batch_head;
+		if (c->m_batch_head == nullptr)
+			c->m_batch_tail = n;
+		c->m_batch_head = n;
+		if (++c->m_batch_count >= remote_batch)
+			c->flush_batch();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	void detail::pool_cache::flush_batch()
+	{
+		if (m_batch_head == nullptr)
+			return;
+
+		std::atomic<pool_node*>& remote = m_batch_owner->m_remote;
+		pool_node*				 head = remote.load(std::memory_order_relaxed);
+		do
+		{
+			m_batch_tail->next = head;
+		} while (remote.compare_exchange_weak(head, m_batch_head, std::memory_order_release, std::memory_order_relaxed) == false);
+
+		m_batch_head = nullptr;
+		m_batch_tail = nullptr;
+		m_batch_count = 0;
+	}
+
+}
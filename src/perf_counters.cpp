@@ -0,0 +1,209 @@
+
+#include "../incl/perf_counters.h"
+
+#if defined(__linux__)
+#	include <cstdlib>
+#	include <cstring>
+
+#	include <linux/perf_event.h>
+#	include <sys/resource.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
+namespace threading
+{
+
+	namespace
+	{
+		// every event before context_switches comes from the perf group
+		constexpr uint32_t hardware_events = (1u << uint32_t(perf_event::context_switches)) - 1;
+	}
+
+#if defined(__linux__)
+
+	namespace
+	{
+		// HITM loads: MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM (XSNP_FWD since ice lake), the same encoding since sandy bridge
+		// THREADING_PERF_TRANSFER_EVENT=<raw config> picks another event, e.g. on other vendors
+		bool cache_line_transfer_event(uint64_t& config)
+		{
+			if (const char* env = std::getenv("THREADING_PERF_TRANSFER_EVENT"))
+			{
+				config = std::strtoull(env, nullptr, 0);
+				return config != 0;
+			}
+#	if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+			__builtin_cpu_init();
+			if (__builtin_cpu_is("intel"))
+			{
+				config = 0x04d2;
+				return true;
+			}
+#	endif
+			return false;
+		}
+
+		// the events join one group under the first that opens, the kernel schedules a group all or nothing,
+		// so every counter covers the same time and ratios like ipc compare like with like
+		int open_event(const uint32_t type, const uint64_t config, const int group_fd)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = type;
+			attr.config = config;
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			attr.exclude_kernel = 1; // allowed up to perf_event_paranoid 2
+			attr.exclude_hv = 1;
+			return int(syscall(SYS_perf_event_open, &attr, 0 /*this thread*/, -1 /*any cpu*/, group_fd, PERF_FLAG_FD_CLOEXEC));
+		}
+
+	}
+
+	perf_counters::perf_counters()
+	{
+		for (int& fd : m_fds)
+			fd = -1;
+
+		uint64_t   transfer_config = 0;
+		const bool has_transfers = cache_line_transfer_event(transfer_config);
+
+		struct event_config
+		{
+			perf_event event;
+			uint32_t   type;
+			uint64_t   config;
+		};
+		const event_config events[] = {
+			{ perf_event::cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ perf_event::instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ perf_event::llc_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ perf_event::cache_line_transfers, PERF_TYPE_RAW, transfer_config },
+		};
+		for (const event_config& e : events)
+		{
+			if (e.event == perf_event::cache_line_transfers && has_transfers == false)
+				continue;
+			// fails as well when the event does not fit in the group next to the others
+			const int fd = open_event(e.type, e.config, m_group_size == 0 ? -1 : m_fds[uint32_t(m_group[0])]);
+			if (fd < 0)
+				continue;
+			m_fds[uint32_t(e.event)] = fd;
+			m_group[m_group_size++] = e.event;
+			m_available |= 1u << uint32_t(e.event);
+		}
+		// the software event happens in the kernel, exclude_kernel would hide every switch
+		m_available |= 1u << uint32_t(perf_event::context_switches);
+	}
+
+	perf_counters::~perf_counters()
+	{
+		// members before the leader
+		for (uint32_t i = m_group_size; i-- > 0;)
+			close(m_fds[uint32_t(m_group[i])]);
+	}
+
+	perf_sample perf_counters::read() const
+	{
+		perf_sample s;
+		s.available = m_available;
+		s.samples = 1;
+		if (m_group_size != 0)
+		{
+			uint64_t	  data[3 + uint32_t(perf_event::count)]; // count, time enabled, time running, values in group order
+			const ssize_t size = ssize_t(sizeof(uint64_t) * (3 + m_group_size));
+			if (::read(m_fds[uint32_t(m_group[0])], data, std::size_t(size)) == size && data[0] == m_group_size)
+			{
+				s.time_enabled = data[1];
+				s.time_running = data[2];
+				for (uint32_t i = 0; i < m_group_size; i++)
+					s.values[uint32_t(m_group[i])] = data[3 + i];
+			}
+			else
+				s.available &= ~hardware_events;
+		}
+
+		rusage usage;
+		if (getrusage(RUSAGE_THREAD, &usage) == 0)
+			s.values[uint32_t(perf_event::context_switches)] = uint64_t(usage.ru_nvcsw) + uint64_t(usage.ru_nivcsw);
+		else
+			s.available &= ~(1u << uint32_t(perf_event::context_switches));
+		return s;
+	}
+
+#else
+
+	perf_counters::perf_counters()
+	{
+		for (int& fd : m_fds)
+			fd = -1;
+	}
+
+	perf_counters::~perf_counters()
+	{
+	}
+
+	perf_sample perf_counters::read() const
+	{
+		perf_sample s;
+		s.samples = 1;
+		return s;
+	}
+
+#endif
+
+	perf_sample perf_counters::delta(const perf_sample& begin, const perf_sample& end)
+	{
+		auto difference = [](const uint64_t from, const uint64_t to) -> uint64_t { return to > from ? to - from : 0; };
+
+		perf_sample d;
+		d.available = begin.available & end.available;
+		d.samples = 1;
+		d.time_enabled = difference(begin.time_enabled, end.time_enabled);
+		d.time_running = difference(begin.time_running, end.time_running);
+		for (uint32_t i = 0; i < uint32_t(perf_event::count); i++)
+			d.values[i] = difference(begin.values[i], end.values[i]);
+
+		if ((d.available & hardware_events) == 0 || d.time_running == d.time_enabled)
+			return d;
+		if (d.time_running == 0)
+		{
+			// enabled but never scheduled in, nothing to extrapolate from
+			d.available &= ~hardware_events;
+			for (uint32_t i = 0; i < uint32_t(perf_event::context_switches); i++)
+				d.values[i] = 0;
+			return d;
+		}
+		const double scale = double(d.time_enabled) / double(d.time_running);
+		for (uint32_t i = 0; i < uint32_t(perf_event::context_switches); i++)
+			d.values[i] = uint64_t(double(d.values[i]) * scale);
+		return d;
+	}
+
+	perf_counters& perf_counters::this_thread()
+	{
+		static thread_local perf_counters counters;
+		return counters;
+	}
+
+	const char* perf_counters::name(const perf_event e)
+	{
+		switch (e)
+		{
+			case perf_event::cycles:
+				return "cycles";
+			case perf_event::instructions:
+				return "instructions";
+			case perf_event::llc_misses:
+				return "llc_misses";
+			case perf_event::cache_line_transfers:
+				return "cache_line_transfers";
+			case perf_event::context_switches:
+				return "context_switches";
+			default:
+				return "?";
+		}
+	}
+
+}
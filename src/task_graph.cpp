@@ -0,0 +1,121 @@
+
+#include "../incl/task_graph.h"
+
+namespace threading
+{
+
+	void task_graph::node::precede(node& successor)
+	{
+		THREADING_ASSERT(&successor.m_graph == &m_graph);
+		THREADING_ASSERT(&successor != this);
+		m_successors.push_back(&successor);
+		successor.m_predecessor_count++;
+		m_graph.m_checked = false;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	task_graph::~task_graph()
+	{
+		wait();
+	}
+
+	bool task_graph::acyclic()
+	{
+		THREADING_ASSERT(m_pool == nullptr); // m_pending is the in-degree scratch
+		if (m_checked)
+			return m_acyclic;
+
+		// Kahn's algorithm: every node of an acyclic graph is reached by removing nodes without predecessors
+		std::vector<node*> ready;
+		for (auto& n : m_nodes)
+		{
+			n.m_pending.store(n.m_predecessor_count, std::memory_order_relaxed);
+			if (n.m_predecessor_count == 0)
+				ready.push_back(&n);
+		}
+		std::size_t reached = 0;
+		while (ready.empty() == false)
+		{
+			node* n = ready.back();
+			ready.pop_back();
+			reached++;
+			for (node* s : n->m_successors)
+			{
+				if (s->m_pending.fetch_sub(1, std::memory_order_relaxed) == 1)
+					ready.push_back(s);
+			}
+		}
+
+		m_acyclic = reached == m_nodes.size();
+		m_checked = true;
+		return m_acyclic;
+	}
+
+	bool task_graph::run(worker_pool& pool)
+	{
+		if (run_async(pool) == false)
+			return false;
+		wait();
+		return true;
+	}
+
+	bool task_graph::run_async(worker_pool& pool)
+	{
+		THREADING_ASSERT(m_pool == nullptr);
+		if (m_nodes.empty())
+			return true;
+		if (acyclic() == false)
+		{
+			THREADING_ASSERT_FALSE("task_graph has a cycle");
+			return false;
+		}
+
+		m_pool = &pool;
+		m_running.add(m_nodes.size());
+
+		for (auto& n : m_nodes)
+			n.m_pending.store(n.m_predecessor_count, std::memory_order_relaxed);
+
+		for (auto& n : m_nodes)
+		{
+			if (n.m_predecessor_count != 0)
+				continue;
+			node* ptr = &n;
+			pool.submit_local([this, ptr]() { _execute(ptr); });
+		}
+		return true;
+	}
+
+	void task_graph::wait()
+	{
+		if (m_pool == nullptr)
+			return;
+		m_pool->wait(m_running);
+		m_pool = nullptr;
+	}
+
+	void task_graph::_execute(node* n)
+	{
+		while (n != nullptr)
+		{
+			n->m_work();
+
+			// the first ready successor continues on this thread, the others go to the local queue
+			node* next = nullptr;
+			for (node* s : n->m_successors)
+			{
+				if (s->m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+					continue;
+				if (next == nullptr)
+					next = s;
+				else
+					m_pool->submit_local([this, s]() { _execute(s); });
+			}
+
+			m_running.done();
+			n = next;
+		}
+	}
+
+}
@@ -1,9 +1,90 @@
 
 #include "../incl/thread_group.h"
+#include "../incl/trace.h"
+
+#if DEV_PLATFORM_LIN()
+#	include <cstring>
+#	include <fstream>
+#	include <sstream>
+
+#	include <pthread.h>
+#	include <sched.h>
+#	include <sys/resource.h>
+#	include <sys/syscall.h>
+#	include <time.h>
+#	include <unistd.h>
+#endif
+
+#if DEV_PLATFORM_WIN()
+#	include <windows.h>
+#endif
 
 namespace threading
 {
 
+	namespace
+	{
+#if DEV_PLATFORM_LIN()
+		struct proc_field
+		{
+			const char* key;
+			uint64_t*	out;
+		};
+
+		// "key:\tvalue" lines of /proc/.../status and "key : value" lines of /proc/.../sched
+		void read_proc_fields(const std::string& path, std::initializer_list<proc_field> fields)
+		{
+			std::ifstream in(path);
+			std::string	  line;
+			while (std::getline(in, line))
+			{
+				for (const proc_field& f : fields)
+				{
+					const std::size_t key_length = std::strlen(f.key);
+					if (line.compare(0, key_length, f.key) != 0)
+						continue;
+					const std::size_t colon = line.find(':', key_length);
+					if (colon != std::string::npos)
+						*f.out = std::strtoull(line.c_str() + colon + 1, nullptr, 10);
+				}
+			}
+		}
+
+		// context switches, migrations and last cpu of any thread of this process
+		void read_task(const int64_t tid, thread_stats& s)
+		{
+			const std::string base = "/proc/self/task/" + std::to_string(tid);
+			read_proc_fields(base + "/status", { { "voluntary_ctxt_switches", &s.voluntary_switches }, { "nonvoluntary_ctxt_switches", &s.involuntary_switches } });
+			read_proc_fields(base + "/sched", { { "se.nr_migrations", &s.migrations } });
+
+			// "tid (comm) state ...": the processor is field 39, comm may contain spaces so count after the last ')'
+			std::ifstream in(base + "/stat");
+			std::string	  stat;
+			std::getline(in, stat);
+			const std::size_t comm_end = stat.rfind(')');
+			if (comm_end == std::string::npos)
+				return;
+			std::istringstream fields(stat.substr(comm_end + 1));
+			std::string		   field;
+			for (int i = 3; i <= 39 && (fields >> field); i++)
+			{
+				if (i == 39)
+					s.current_cpu = int32_t(std::strtol(field.c_str(), nullptr, 10));
+			}
+		}
+
+		uint64_t clock_ns(const clockid_t clock)
+		{
+			timespec ts;
+			if (clock_gettime(clock, &ts) != 0)
+				return 0;
+			return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+		}
+#endif
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
 	thread_group::~thread_group()
 	{
 		for (auto& t : m_thread_handles)
@@ -12,6 +93,107 @@ namespace threading
 	void thread_group::swap(thread_group& other)
 	{
 		m_thread_handles.swap(other.m_thread_handles);
+		m_workers.swap(other.m_workers);
+	}
+
+	thread_stats thread_group::stats(const std::size_t index) const
+	{
+		THREADING_ASSERT(index < m_workers.size());
+		worker& w = *m_workers[index];
+		{
+			std::lock_guard<std::mutex> _(w.lock);
+			if (w.last.finished)
+				return w.last;
+		}
+
+		thread_stats s;
+		s.name = w.name;
+		s.os_id = w.os_id.load(std::memory_order_acquire);
+		if (s.os_id == 0)
+			return s; // not running yet
+
+#if DEV_PLATFORM_LIN()
+		clockid_t cpu_clock;
+		if (pthread_getcpuclockid(const_cast<std::thread&>(m_thread_handles[index]).native_handle(), &cpu_clock) == 0)
+			s.cpu_time_ns = clock_ns(cpu_clock);
+		read_task(s.os_id, s);
+#elif DEV_PLATFORM_WIN()
+		FILETIME creation, exit, kernel, user;
+		if (GetThreadTimes(const_cast<std::thread&>(m_thread_handles[index]).native_handle(), &creation, &exit, &kernel, &user))
+		{
+			auto ticks = [](const FILETIME& t) { return (uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+			s.cpu_time_ns = (ticks(kernel) + ticks(user)) * 100;
+		}
+#endif
+
+		// the thread may have exited while we read, its own last values are the better ones
+		std::lock_guard<std::mutex> _(w.lock);
+		return w.last.finished ? w.last : s;
+	}
+
+	std::vector<thread_stats> thread_group::stats() const
+	{
+		std::vector<thread_stats> r;
+		r.reserve(m_workers.size());
+		for (std::size_t i = 0; i < m_workers.size(); i++)
+			r.push_back(stats(i));
+		return r;
+	}
+
+	thread_stats thread_group::current_thread_stats()
+	{
+		thread_stats s;
+#if DEV_PLATFORM_LIN()
+		char name[16] = {};
+		if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+			s.name = name;
+		s.os_id = int64_t(syscall(SYS_gettid));
+		s.cpu_time_ns = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+		read_task(s.os_id, s);
+		rusage usage;
+		if (getrusage(RUSAGE_THREAD, &usage) == 0)
+		{
+			s.voluntary_switches = uint64_t(usage.ru_nvcsw);
+			s.involuntary_switches = uint64_t(usage.ru_nivcsw);
+		}
+		s.current_cpu = int32_t(sched_getcpu());
+#elif DEV_PLATFORM_WIN()
+		s.os_id = int64_t(GetCurrentThreadId());
+		FILETIME creation, exit, kernel, user;
+		if (GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		{
+			auto ticks = [](const FILETIME& t) { return (uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+			s.cpu_time_ns = (ticks(kernel) + ticks(user)) * 100;
+		}
+		s.current_cpu = int32_t(GetCurrentProcessorNumber());
+#endif
+		return s;
+	}
+
+	void thread_group::_begin_worker(worker& w)
+	{
+		if (w.name.empty() == false)
+		{
+#if DEV_PLATFORM_LIN()
+			pthread_setname_np(pthread_self(), w.name.substr(0, 15).c_str());
+#endif
+			trace::set_thread_name(w.name.c_str());
+		}
+#if DEV_PLATFORM_LIN()
+		w.os_id.store(int64_t(syscall(SYS_gettid)), std::memory_order_release);
+#elif DEV_PLATFORM_WIN()
+		w.os_id.store(int64_t(GetCurrentThreadId()), std::memory_order_release);
+#endif
+	}
+
+	void thread_group::_end_worker(worker& w)
+	{
+		thread_stats s = current_thread_stats();
+		s.name = w.name;
+		s.finished = true;
+
+		std::lock_guard<std::mutex> _(w.lock);
+		w.last = std::move(s);
 	}
 
 }
@@ -1,17 +1,84 @@
 
 #include "../incl/thread_primitives.h"
 
+#if defined(__linux__)
+#	include <linux/futex.h>
+#	include <sys/syscall.h>
+#	include <unistd.h>
+#endif
+
 namespace threading
 {
 
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	void detail::park_word(const std::atomic<uint32_t>& word, const uint32_t expected) noexcept
+	{
+#if defined(__linux__)
+		syscall(SYS_futex, const_cast<std::atomic<uint32_t>*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+		word.wait(expected, std::memory_order_relaxed);
+#else
+		(void)word;
+		(void)expected;
+		std::this_thread::yield();
+#endif
+	}
+
+	namespace
+	{
+		detail::parking_slot _parking_slots[64];
+	}
+
+	detail::parking_slot& detail::parking_slot_for(const void* address) noexcept
+	{
+		const uint64_t h = uint64_t(reinterpret_cast<uintptr_t>(address)) * 0x9E3779B97F4A7C15ull;
+		return _parking_slots[h >> 58];
+	}
+
+	void detail::unpark_word(std::atomic<uint32_t>& word, const bool all) noexcept
+	{
+#if defined(__linux__)
+		syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, all ? INT32_MAX : 1, nullptr, nullptr, 0);
+#elif defined(__cpp_lib_atomic_wait)
+		if (all)
+			word.notify_all();
+		else
+			word.notify_one();
+#else
+		(void)word;
+		(void)all;
+#endif
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	void spin_lock::_lock_contended() noexcept
+	{
+		THREADING_TRACE_SCOPE("spin_lock wait");
+		for (uint32_t i = 0; i < lock_spin_count; i++)
+		{
+			threading_impl_spin_yield();
+			uint32_t state = flag.load(std::memory_order_relaxed);
+			if (state == 0 && flag.compare_exchange_weak(state, 1, std::memory_order_acquire))
+				return;
+		}
+		// from here on the lock is taken as contended, so our unlock() wakes the next parked thread
+		while (flag.exchange(2, std::memory_order_acquire) != 0)
+			detail::park_word(flag, 2);
+	}
+
 	//--------------------------------------------------------------------------------------------------------------------------------
 	constexpr uint32_t _multi_read_lock_pivot = 2147483648;
 
 	void mr_spin_lock::write_lock()
 	{
 		m_readers.fetch_add(_multi_read_lock_pivot, std::memory_order_acquire);
+		if (m_readers.load(std::memory_order_acquire) == _multi_read_lock_pivot)
+			return;
 
-		while (m_readers.load(std::memory_order_relaxed) != _multi_read_lock_pivot)
+		THREADING_TRACE_SCOPE("mr_spin_lock write wait");
+		while (m_readers.load(std::memory_order_acquire) != _multi_read_lock_pivot)
 		{
 			// yield ?
 		}
@@ -32,6 +99,7 @@ namespace threading
 
 			m_readers.fetch_sub(1, std::memory_order_release);
 
+			THREADING_TRACE_SCOPE("mr_spin_lock read wait");
 			while (m_readers.load(std::memory_order_relaxed) >= _multi_read_lock_pivot)
 			{
 				// yield ?
@@ -71,41 +139,42 @@ namespace threading
 
 			if (m_count > 0)
 			{
-				original_generataion = m_generation;
+				original_generataion = m_generation->load();
 				m_cv.notify_all();
 			}
 		}
-		while (m_generation.load() == original_generataion)
+		while (m_generation->load() == original_generataion)
 			std::this_thread::yield();
 	}
 
 	void barrier::arrive_and_wait()
 	{
+		THREADING_TRACE_SCOPE("barrier wait");
 		std::size_t base_generation;
 		{
 			std::unique_lock<std::mutex> lk(m_lock);
 
-			base_generation = m_generation;
+			base_generation = m_generation->load();
 
 			m_count++;
 
 			if (m_count == m_group_size)
 			{
-				m_generation++;
+				m_generation->fetch_add(1);
 				m_cv.notify_all();
 			}
 			else
 			{
-				m_cv.wait(lk, [this, base_generation]() { return base_generation != m_generation; });
+				m_cv.wait(lk, [this, base_generation]() { return base_generation != m_generation->load(); });
 			}
 
 			if ((--m_count) == 0)
 			{
-				m_generation++;
+				m_generation->fetch_add(1);
 				return;
 			}
 		}
-		while (m_generation.load() != (base_generation + 2))
+		while (m_generation->load() != (base_generation + 2))
 			std::this_thread::yield();
 	}
 
@@ -125,22 +194,54 @@ namespace threading
 			else
 				m_cv.wait(lk, [this]() { return m_count == m_group_size; });
 		}
-		while (m_entered_count.load() != 0)
+		while (m_entered_count->load() != 0)
 			std::this_thread::yield();
 	}
 
 	void latch::arrive_and_wait()
 	{
-		m_entered_count++;
+		THREADING_TRACE_SCOPE("latch wait");
+		m_entered_count->fetch_add(1);
+		async_waiter* waiters = nullptr;
 		{
 			std::unique_lock<std::mutex> lk(m_lock);
 			m_count++;
 			if (m_count == m_group_size)
+			{
+				waiters = m_async_waiters.take_all();
 				m_cv.notify_all();
+			}
 			else
+			{
 				m_cv.wait(lk, [this]() { return m_count == m_group_size; });
+			}
+		}
+		async_waiter_list::resume_all(waiters);
+		m_entered_count->fetch_sub(1);
+	}
+
+	bool latch::arrive_async(async_waiter& w)
+	{
+		m_entered_count->fetch_add(1);
+		async_waiter* waiters = nullptr;
+		bool		  complete = false;
+		{
+			std::unique_lock<std::mutex> lk(m_lock);
+			m_count++;
+			if (m_count == m_group_size)
+			{
+				waiters = m_async_waiters.take_all();
+				m_cv.notify_all();
+				complete = true;
+			}
+			else
+			{
+				m_async_waiters.push_back(w);
+			}
 		}
-		m_entered_count--;
+		async_waiter_list::resume_all(waiters);
+		m_entered_count->fetch_sub(1);
+		return complete;
 	}
 
 	//--------------------------------------------------------------------------------------------------------------------------------
@@ -153,7 +254,7 @@ namespace threading
 	swap_barrier::~swap_barrier()
 	{
 		break_locks();
-		while (m_entered_count.load() != 0)
+		while (m_entered_count->load() != 0)
 			std::this_thread::yield();
 	}
 
@@ -171,7 +272,8 @@ namespace threading
 
 	void swap_barrier::arrive_and_wait()
 	{
-		m_entered_count++;
+		THREADING_TRACE_SCOPE("swap_barrier wait");
+		m_entered_count->fetch_add(1);
 		{
 			std::unique_lock<std::mutex> lk(m_lock);
 			m_count++;
@@ -181,12 +283,13 @@ namespace threading
 
 			m_cv_wait.wait(lk, [this]() { return m_count == 0 || broken(); });
 		}
-		m_entered_count--;
+		m_entered_count->fetch_sub(1);
 	}
 
 	void swap_barrier::arrive_and_lock()
 	{
-		m_entered_count++;
+		THREADING_TRACE_SCOPE("swap_barrier lock");
+		m_entered_count->fetch_add(1);
 
 		std::unique_lock<std::mutex> lk(m_lock);
 		m_count++;
@@ -205,7 +308,7 @@ namespace threading
 			m_cv_wait.notify_all();
 		}
 		m_lock.unlock();
-		m_entered_count--;
+		m_entered_count->fetch_sub(1);
 	}
 
 	//--------------------------------------------------------------------------------------------------------------------------------
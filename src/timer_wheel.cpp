@@ -0,0 +1,269 @@
+
+#include "../incl/timer_wheel.h"
+
+namespace threading
+{
+
+	timer_wheel::timer_wheel(const uint32_t tick_ms)
+		: m_tick_ms(tick_ms > 0 ? tick_ms : 1)
+		, m_start(std::chrono::steady_clock::now())
+	{
+		for (auto& level : m_wheel)
+			for (auto& slot : level)
+				slot = invalid_index;
+
+		m_thread.spawn(1, [this]() { _timer_loop(); });
+	}
+
+	timer_wheel::~timer_wheel()
+	{
+		std::unique_lock<std::mutex> lk(m_lock);
+		m_stop = true;
+		m_wake.notify_all();
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	timer_wheel::timer_id timer_wheel::schedule_after(const uint32_t delay_ms, callback_t&& _func)
+	{
+		return _schedule(delay_ms, 0, std::move(_func));
+	}
+
+	timer_wheel::timer_id timer_wheel::schedule_every(const uint32_t period_ms, callback_t&& _func)
+	{
+		return _schedule(period_ms, period_ms, std::move(_func));
+	}
+
+	bool timer_wheel::cancel(const timer_id id)
+	{
+		const uint32_t index = uint32_t(id & 0xffffffff);
+		const uint32_t generation = uint32_t(id >> 32);
+
+		std::unique_lock<std::mutex> lk(m_lock);
+		if (index >= m_nodes.size())
+			return false;
+		timer_node& n = m_nodes[index];
+		if (n.generation != generation || n.active == false)
+			return false;
+
+		n.active = false;
+		m_active--;
+		if (n.firing == false) // a firing node is released by the timer thread
+		{
+			_unlink(index);
+			_free(index);
+		}
+		return true;
+	}
+
+	std::size_t timer_wheel::size()
+	{
+		std::unique_lock<std::mutex> lk(m_lock);
+		return m_active;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	uint32_t timer_wheel::_to_ticks(const uint32_t ms) const
+	{
+		uint32_t t = (ms + m_tick_ms - 1) / m_tick_ms;
+		return t > 0 ? t : 1;
+	}
+
+	uint64_t timer_wheel::_now_tick() const
+	{
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start);
+		return uint64_t(elapsed.count()) / m_tick_ms;
+	}
+
+	timer_wheel::timer_id timer_wheel::_schedule(const uint32_t delay_ms, const uint32_t period_ms, callback_t&& _func)
+	{
+		std::unique_lock<std::mutex> lk(m_lock);
+
+		// an empty wheel is not advanced by the timer thread, catch up before computing the expiration
+		if (m_active == 0)
+			m_current_tick = _now_tick();
+
+		uint32_t index = m_free_head;
+		if (index != invalid_index)
+		{
+			m_free_head = m_nodes[index].next;
+		}
+		else
+		{
+			index = uint32_t(m_nodes.size());
+			m_nodes.emplace_back();
+		}
+
+		timer_node& n = m_nodes[index];
+		n.callback = std::move(_func);
+		n.expires = _now_tick() + 1 + _to_ticks(delay_ms); // the current tick is partially elapsed
+		n.period = period_ms > 0 ? _to_ticks(period_ms) : 0;
+		n.active = true;
+		n.firing = false;
+		_link(index);
+
+		if (m_active++ == 0)
+			m_wake.notify_one(); // timer thread sleeps without a deadline when there is nothing to do
+
+		return (uint64_t(n.generation) << 32) | index;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	void timer_wheel::_link(const uint32_t index)
+	{
+		timer_node& n = m_nodes[index];
+
+		if (n.expires < m_current_tick)
+			n.expires = m_current_tick; // fires with the next processed tick
+		uint64_t delta = n.expires - m_current_tick;
+		uint64_t expires = n.expires;
+		uint32_t level = 0;
+		while (level + 1 < level_count && delta >= (uint64_t(1) << (level_bits * (level + 1))))
+			level++;
+		if (delta >= (uint64_t(1) << (level_bits * level_count)))
+			expires = m_current_tick + (uint64_t(1) << (level_bits * level_count)) - 1; // clamp, cascades again later
+
+		n.level = uint8_t(level);
+		n.slot = uint16_t((expires >> (level_bits * level)) & (level_slots - 1));
+
+		uint32_t& head = m_wheel[n.level][n.slot];
+		n.prev = invalid_index;
+		n.next = head;
+		if (head != invalid_index)
+			m_nodes[head].prev = index;
+		head = index;
+	}
+
+	void timer_wheel::_unlink(const uint32_t index)
+	{
+		timer_node& n = m_nodes[index];
+		if (n.prev != invalid_index)
+			m_nodes[n.prev].next = n.next;
+		else
+			m_wheel[n.level][n.slot] = n.next;
+		if (n.next != invalid_index)
+			m_nodes[n.next].prev = n.prev;
+		n.next = invalid_index;
+		n.prev = invalid_index;
+	}
+
+	void timer_wheel::_free(const uint32_t index)
+	{
+		timer_node& n = m_nodes[index];
+		n.callback = nullptr;
+		n.generation++;
+		if (n.generation == 0)
+			n.generation = 1;
+		n.next = m_free_head;
+		m_free_head = index;
+	}
+
+	void timer_wheel::_cascade(const uint32_t level, const uint32_t slot)
+	{
+		uint32_t index = m_wheel[level][slot];
+		m_wheel[level][slot] = invalid_index;
+		while (index != invalid_index)
+		{
+			uint32_t next = m_nodes[index].next;
+			_link(index);
+			index = next;
+		}
+	}
+
+	void timer_wheel::_advance(const uint64_t target_tick, std::vector<uint32_t>& expired)
+	{
+		while (m_current_tick <= target_tick)
+		{
+			// entering a new round of a level moves the matching slot of the level above down
+			for (uint32_t level = 1; level < level_count; level++)
+			{
+				if ((m_current_tick & ((uint64_t(1) << (level_bits * level)) - 1)) != 0)
+					break;
+				_cascade(level, uint32_t((m_current_tick >> (level_bits * level)) & (level_slots - 1)));
+			}
+
+			uint32_t& head = m_wheel[0][m_current_tick & (level_slots - 1)];
+			uint32_t  index = head;
+			head = invalid_index;
+			while (index != invalid_index)
+			{
+				timer_node& n = m_nodes[index];
+				uint32_t	next = n.next;
+				n.next = invalid_index;
+				n.prev = invalid_index;
+				if (n.expires > m_current_tick)
+				{
+					_link(index); // clamped timer that is not due yet
+				}
+				else
+				{
+					n.firing = true;
+					expired.push_back(index);
+				}
+				index = next;
+			}
+
+			m_current_tick++;
+			if (expired.empty() == false)
+				break;
+		}
+	}
+
+	void timer_wheel::_timer_loop()
+	{
+		std::vector<uint32_t>	 expired;
+		std::vector<timer_node*> firing;
+
+		std::unique_lock<std::mutex> lk(m_lock);
+		while (m_stop == false)
+		{
+			uint64_t now = _now_tick();
+			if (m_current_tick <= now && m_active > 0)
+			{
+				_advance(now, expired);
+			}
+			else
+			{
+				if (m_active == 0)
+					m_wake.wait(lk);
+				else
+				{
+					m_wake.wait_until(lk, m_start + std::chrono::milliseconds((m_current_tick) * m_tick_ms));
+				}
+				continue;
+			}
+
+			if (expired.empty())
+				continue;
+
+			firing.clear();
+			for (uint32_t index : expired)
+				firing.push_back(&m_nodes[index]);
+
+			lk.unlock();
+			for (timer_node* n : firing)
+				n->callback();
+			lk.lock();
+
+			for (uint32_t index : expired)
+			{
+				timer_node& n = m_nodes[index];
+				n.firing = false;
+				if (n.active && n.period > 0)
+				{
+					n.expires = m_current_tick - 1 + n.period;
+					_link(index);
+					continue;
+				}
+				if (n.active)
+					m_active--;
+				n.active = false;
+				_free(index);
+			}
+			expired.clear();
+		}
+	}
+
+}
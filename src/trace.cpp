@@ -0,0 +1,215 @@
+
+#include "../incl/trace.h"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace threading
+{
+
+#if defined(THREADING_TRACE)
+
+	namespace
+	{
+		struct trace_registry
+		{
+			trace_registry()
+				: tick0(trace::detail::now())
+				, steady0(std::chrono::steady_clock::now())
+			{
+			}
+
+			// ticks of detail::now() are rdtsc or steady_clock units, both measured against steady_clock
+			double ns_per_tick()
+			{
+				auto elapsed = std::chrono::steady_clock::now() - steady0;
+				if (elapsed < std::chrono::milliseconds(2))
+				{
+					std::this_thread::sleep_for(std::chrono::milliseconds(2));
+					elapsed = std::chrono::steady_clock::now() - steady0;
+				}
+				const uint64_t ticks = trace::detail::now() - tick0;
+				return double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / double(ticks);
+			}
+
+			std::mutex											   lock;
+			std::vector<std::unique_ptr<trace::detail::ring>> rings;
+			std::vector<trace::detail::ring*>					   free_rings; // of exited threads
+			std::vector<std::string>							   names; // by tid
+			trace::detail::ring								   discard; // written after a thread gave its ring back, never dumped
+
+			const uint64_t								tick0;
+			const std::chrono::steady_clock::time_point steady0;
+		};
+
+		trace_registry& registry()
+		{
+			static trace_registry* r = new trace_registry(); // threads may still record during static destruction
+			return *r;
+		}
+
+		// gives the ring of the thread back when it exits, so thread churn does not grow the registry
+		struct ring_owner
+		{
+			trace::detail::ring* ring = nullptr;
+
+			~ring_owner()
+			{
+				if (ring == nullptr)
+					return;
+				trace_registry& r = registry();
+				// thread_locals destroyed after this one may still record
+				trace::detail::t_ring = &r.discard;
+				std::lock_guard<std::mutex> _(r.lock);
+				r.free_rings.push_back(ring);
+			}
+		};
+
+		thread_local ring_owner t_ring_owner;
+
+		void write_escaped(std::ostream& out, const char* s)
+		{
+			for (; *s != 0; s++)
+			{
+				if (*s == '"' || *s == '\\')
+					out << '\\' << *s;
+				else if (uint8_t(*s) < 0x20)
+					out << ' ';
+				else
+					out << *s;
+			}
+		}
+	}
+
+	trace::detail::ring* trace::detail::register_thread()
+	{
+		trace_registry&				r = registry();
+		std::lock_guard<std::mutex> _(r.lock);
+		ring*						reused = nullptr;
+		if (r.free_rings.empty() == false)
+		{
+			// the new thread takes over the tid, the events and the name of the exited one are dropped
+			reused = r.free_rings.back();
+			r.free_rings.pop_back();
+			reused->head.store(0, std::memory_order_relaxed);
+			r.names[reused->tid - 1].clear();
+		}
+		else
+		{
+			r.rings.emplace_back(new ring());
+			reused = r.rings.back().get();
+			r.names.emplace_back();
+			reused->tid = uint32_t(r.names.size());
+		}
+		t_ring_owner.ring = reused;
+		return reused;
+	}
+
+	void trace::dump(std::ostream& out)
+	{
+		trace_registry&				r = registry();
+		std::lock_guard<std::mutex> _(r.lock);
+		const double				ns_per_tick = r.ns_per_tick();
+
+		const auto flags = out.flags();
+		const auto precision = out.precision();
+		out << std::fixed << std::setprecision(3);
+
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		for (const auto& ring : r.rings)
+		{
+			const std::string& name = r.names[ring->tid - 1];
+			if (name.empty() == false)
+			{
+				out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid << ",\"args\":{\"name\":\"";
+				write_escaped(out, name.c_str());
+				out << "\"}}";
+				first = false;
+			}
+
+			const uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint32_t	   depth = 0; // open begin events, an end whose begin was overwritten is left out
+			for (uint64_t i = head > ring->capacity ? head - ring->capacity : 0; i < head; i++)
+			{
+				const detail::event& e = ring->events[i & (ring->capacity - 1)];
+				const char*			 event_name = e.name.load(std::memory_order_relaxed);
+				const uint64_t		 stamp = e.stamp.load(std::memory_order_relaxed);
+				const detail::kind	 k = detail::kind(stamp >> detail::kind_shift);
+				if (event_name == nullptr || (k == detail::kind::end && depth == 0))
+					continue;
+
+				const uint64_t ticks = stamp & detail::ticks_mask;
+				out << (first ? "\n" : ",\n") << "{\"name\":\"";
+				write_escaped(out, event_name);
+				out << "\",\"pid\":1,\"tid\":" << ring->tid << ",\"ts\":" << double(int64_t(ticks - (r.tick0 & detail::ticks_mask))) * ns_per_tick / 1000.0;
+				if (k == detail::kind::begin)
+				{
+					out << ",\"ph\":\"B\"}";
+					depth++;
+				}
+				else if (k == detail::kind::end)
+				{
+					out << ",\"ph\":\"E\"}";
+					depth--;
+				}
+				else
+					out << ",\"ph\":\"i\",\"s\":\"t\"}";
+				first = false;
+			}
+		}
+		out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+	void trace::clear()
+	{
+		trace_registry&				r = registry();
+		std::lock_guard<std::mutex> _(r.lock);
+		for (auto& ring : r.rings)
+			ring->head.store(0, std::memory_order_release);
+	}
+
+	void trace::set_thread_name(const char* name)
+	{
+		detail::ring*				ring = detail::local_ring();
+		trace_registry&				r = registry();
+		std::lock_guard<std::mutex> _(r.lock);
+		if (ring->tid != 0) // not the discard ring of an exiting thread
+			r.names[ring->tid - 1] = name;
+	}
+
+#else
+
+	void trace::dump(std::ostream& out)
+	{
+		out << "{\"traceEvents\":[]}\n";
+	}
+
+	void trace::clear()
+	{
+	}
+
+	void trace::set_thread_name(const char*)
+	{
+	}
+
+#endif
+
+	bool trace::dump_file(const char* path)
+	{
+		std::ofstream out(path, std::ios::binary);
+		if (out.is_open() == false)
+			return false;
+		dump(out);
+		return bool(out);
+	}
+
+}
@@ -0,0 +1,185 @@
+
+#include "../incl/worker_pool.h"
+
+namespace threading
+{
+
+	static thread_local worker_pool* t_current_pool = nullptr;
+	static thread_local std::size_t	 t_current_index = 0;
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	worker_pool::worker_pool(const std::size_t worker_count)
+		: m_worker_count(worker_count)
+		, m_queues(new worker_queue[worker_count + 1])
+	{
+		THREADING_ASSERT(worker_count > 0);
+		for (std::size_t i = 0; i < worker_count; i++)
+			m_threads.spawn(1, [this, i]() { _worker_loop(i); });
+	}
+
+	worker_pool::~worker_pool()
+	{
+		std::unique_lock<std::mutex> lk(m_sleep_lock);
+		m_stop = true;
+		m_sleep_trigger.notify_all();
+	}
+
+	worker_pool* worker_pool::current()
+	{
+		return t_current_pool;
+	}
+	std::size_t worker_pool::current_index()
+	{
+		return t_current_index;
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	void worker_pool::submit(task_t&& task)
+	{
+		_push(m_queues[m_worker_count], std::move(task));
+	}
+
+	void worker_pool::submit_local(task_t&& task)
+	{
+		if (t_current_pool == this)
+			_push(m_queues[t_current_index], std::move(task));
+		else
+			_push(m_queues[m_worker_count], std::move(task));
+	}
+
+	bool worker_pool::local_queue_empty()
+	{
+		if (t_current_pool != this)
+			return true;
+		worker_queue& q = m_queues[t_current_index];
+		std::lock_guard<threading::spin_lock> _(q.lock);
+		return q.tasks.empty();
+	}
+
+	bool worker_pool::try_run_one()
+	{
+		task_t task;
+		std::size_t index = t_current_pool == this ? t_current_index : m_worker_count;
+		if (_pop_task(index, task) == false)
+			return false;
+		task();
+		return true;
+	}
+
+	void worker_pool::wait(join_counter& counter)
+	{
+		while (counter.finished() == false)
+		{
+			if (try_run_one())
+				continue;
+			if (t_current_pool == this)
+			{
+				// the remaining tasks are executing on other workers
+				std::this_thread::yield();
+				continue;
+			}
+			counter.wait();
+			return;
+		}
+		// wait for the last done() to release the counter
+		std::lock_guard<std::mutex> _(counter.m_lock);
+	}
+
+	//--------------------------------------------------------------------------------------------------------------------------------
+
+	void worker_pool::_push(worker_queue& q, task_t&& task)
+	{
+		m_queued.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::lock_guard<threading::spin_lock> _(q.lock);
+			q.tasks.push_back(std::move(task));
+		}
+		if (m_sleeping.load(std::memory_order_seq_cst) > 0)
+		{
+			std::unique_lock<std::mutex> lk(m_sleep_lock);
+			m_sleep_trigger.notify_one();
+		}
+	}
+
+	bool worker_pool::_pop_task(const std::size_t index, task_t& out)
+	{
+		if (m_queued.load(std::memory_order_acquire) == 0)
+			return false;
+
+		// local tasks LIFO, keeps the most recent data hot
+		if (index < m_worker_count)
+		{
+			worker_queue& q = m_queues[index];
+			std::lock_guard<threading::spin_lock> _(q.lock);
+			if (q.tasks.empty() == false)
+			{
+				out = std::move(q.tasks.back());
+				q.tasks.pop_back();
+				m_queued.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		{
+			worker_queue& q = m_queues[m_worker_count];
+			std::lock_guard<threading::spin_lock> _(q.lock);
+			if (q.tasks.empty() == false)
+			{
+				out = std::move(q.tasks.front());
+				q.tasks.pop_front();
+				m_queued.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return _steal_task(index, out);
+	}
+
+	bool worker_pool::_steal_task(const std::size_t index, task_t& out)
+	{
+		// steal the oldest task from other workers
+		for (std::size_t i = 1; i <= m_worker_count; i++)
+		{
+			worker_queue& q = m_queues[(index + i) % m_worker_count];
+			if (&q == &m_queues[index])
+				continue;
+			std::lock_guard<threading::spin_lock> _(q.lock);
+			if (q.tasks.empty() == false)
+			{
+				out = std::move(q.tasks.front());
+				q.tasks.pop_front();
+				m_queued.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void worker_pool::_worker_loop(const std::size_t index)
+	{
+		t_current_pool = this;
+		t_current_index = index;
+
+		task_t task;
+		while (true)
+		{
+			if (_pop_task(index, task))
+			{
+				task();
+				task = nullptr;
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lk(m_sleep_lock);
+			m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+			m_sleep_trigger.wait(lk, [this]() { return m_queued.load(std::memory_order_seq_cst) > 0 || m_stop; });
+			m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+
+			if (m_stop && m_queued.load() == 0)
+				break;
+		}
+
+		t_current_pool = nullptr;
+	}
+
+}
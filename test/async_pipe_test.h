@@ -121,9 +121,236 @@ void test_async_pipe3()
 	p.evict(threads.size(), 0);
 }
 
+void test_async_pipe_close_drain()
+{
+	threading::async_pipe<uint64_t> p;
+
+	std::atomic<uint64_t>	 sum { 0 };
+	std::atomic<std::size_t> left { 0 };
+	threading::latch		 started(33);
+
+	{
+		threading::thread_group threads;
+		threads.spawn(32, [&]() {
+			p.consume_loop_or_wait([&](const uint64_t value) {
+				if (value == 0)
+					started.arrive_and_wait();
+				sum += value;
+			});
+			left++;
+		});
+
+		// every consumer holds one of the first items until all of them are attached
+		for (std::size_t i = 0; i < threads.size(); i++)
+			TEST_ASSERT(p.push_back(0));
+		started.arrive_and_wait();
+
+		std::size_t vc = 4096;
+		for (std::size_t i = 0; i < vc; i++)
+			TEST_ASSERT(p.push_back(1));
+
+		p.close_and_wait(threading::close_policy::drain);
+
+		TEST_ASSERT(p.closed());
+		TEST_ASSERT(sum.load() == vc);
+		TEST_ASSERT(p.push_back(1) == false);
+		TEST_ASSERT(p.consume_loop([&](const uint64_t value) { sum += value; }) == false);
+		TEST_ASSERT(sum.load() == vc);
+	}
+	TEST_ASSERT(left.load() == 32);
+}
+
+void test_async_pipe_close_drop()
+{
+	using namespace std::chrono_literals;
+
+	threading::async_pipe<uint64_t> p;
+
+	std::atomic<uint64_t> consumed { 0 };
+
+	threading::thread_group threads;
+	threads.spawn(4, [&]() {
+		p.consume_loop_or_wait([&](const uint64_t) {
+			std::this_thread::sleep_for(1ms);
+			consumed++;
+		});
+	});
+
+	std::size_t vc = 1000;
+	for (std::size_t i = 0; i < vc; i++)
+		p.push_back(1);
+
+	p.close(threading::close_policy::drop);
+	p.wait_closed();
+
+	TEST_ASSERT(consumed.load() < vc);
+	TEST_ASSERT(p.empty());
+}
+
+void test_async_pipe_priority()
+{
+	using pipe_t = threading::priority_async_pipe<uint32_t, 3>;
+
+	{
+		pipe_t p;
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			p.push_back(200 + i, 2);
+			p.push_back(100 + i, 1);
+			p.push_back(i, 0);
+		}
+		TEST_ASSERT(p.storage().depth(0) == 10);
+		TEST_ASSERT(p.storage().depth(2) == 10);
+
+		std::vector<uint32_t> order;
+		{
+			threading::thread_group threads;
+			threads.spawn(1, [&]() { p.consume_loop_or_wait([&](const uint32_t v) { order.push_back(v); }); });
+			p.close_and_wait();
+		}
+
+		// high lanes first, FIFO within a lane
+		TEST_ASSERT(order.size() == 30);
+		for (uint32_t i = 0; i < 30; i++)
+			TEST_ASSERT(order[i] == (i / 10) * 100 + i % 10);
+		TEST_ASSERT(p.storage().depth(0) == 0);
+	}
+	{
+		// a low lane passed over 4 times is served before the high lane
+		pipe_t p(4u);
+		p.push_back(1000, 2);
+		for (uint32_t i = 0; i < 20; i++)
+			p.push_back(i, 0);
+
+		std::vector<uint32_t> order;
+		{
+			threading::thread_group threads;
+			threads.spawn(1, [&]() { p.consume_loop_or_wait([&](const uint32_t v) { order.push_back(v); }); });
+			p.close_and_wait();
+		}
+
+		TEST_ASSERT(order.size() == 21);
+		TEST_ASSERT(order[4] == 1000);
+	}
+}
+
+void test_async_pipe_spin()
+{
+	using namespace std::chrono_literals;
+
+	threading::async_pipe<uint64_t> p;
+
+	std::atomic<uint64_t>	 sum { 0 };
+	std::atomic<std::size_t> left { 0 };
+	const std::size_t		 vc = 20000;
+	{
+		threading::thread_group threads;
+		// one consumer that never sleeps, two that poll briefly and then sleep
+		threads.spawn(1, [&]() {
+			p.consume_loop_or_spin([&](const uint64_t value) { sum += value; }, p.spin_forever);
+			left++;
+		});
+		threads.spawn(2, [&]() {
+			p.consume_loop_or_spin([&](const uint64_t value) { sum += value; }, 20us);
+			left++;
+		});
+
+		for (std::size_t i = 0; i < vc; i++)
+		{
+			TEST_ASSERT(p.push_back(1));
+			if (i % 1000 == 0)
+				std::this_thread::sleep_for(1ms); // consumers run out of budget and sleep
+		}
+		p.wait_for_empty();
+		TEST_ASSERT(sum.load() == vc);
+
+		// spinning consumers leave on evict() like sleeping ones
+		p.evict(3);
+	}
+	TEST_ASSERT(left.load() == 3);
+	TEST_ASSERT(p.empty());
+}
+
+void test_async_pipe_spin_forever()
+{
+	threading::async_pipe<uint64_t> p;
+
+	std::atomic<uint64_t> sum { 0 };
+	uint32_t			  max_sleeping = 0;
+	const std::size_t	  vc = 20000;
+	{
+		threading::thread_group threads;
+		// several spin_forever consumers leave their poll for the same item, the ones that lose it keep polling
+		threads.spawn(3, [&]() {
+			p.consume_loop_or_spin(
+				[&](const uint64_t value) {
+					sum += value;
+					std::this_thread::yield(); // lets the others poll while this one holds an item
+				},
+				p.spin_forever);
+		});
+
+		for (std::size_t i = 0; i < vc; i++)
+		{
+			TEST_ASSERT(p.push_back(1));
+			if (i % 64 == 0)
+				std::this_thread::yield();
+			max_sleeping = std::max(max_sleeping, p.stats().sleeping_consumers);
+		}
+		while (sum.load() != vc)
+		{
+			max_sleeping = std::max(max_sleeping, p.stats().sleeping_consumers);
+			std::this_thread::yield();
+		}
+		p.evict(3);
+	}
+	TEST_ASSERT(max_sleeping == 0);
+	TEST_ASSERT(p.stats().wakeups == 0);
+	TEST_ASSERT(p.empty());
+}
+
+void test_async_pipe_stats()
+{
+	threading::async_pipe<uint64_t> p;
+	for (uint64_t i = 0; i < 10; i++)
+		TEST_ASSERT(p.push_back(i));
+
+	auto st = p.stats();
+	TEST_ASSERT(st.depth == 10 && p.depth() == 10);
+	TEST_ASSERT(st.peak_depth == 10 && st.pushed == 10 && st.consumed == 0);
+
+	TEST_ASSERT(p.consume_loop([](uint64_t&&) {}));
+	st = p.stats();
+	TEST_ASSERT(st.depth == 0 && st.peak_depth == 10 && st.consumed == 10);
+	TEST_ASSERT(st.active_consumers == 0 && st.sleeping_consumers == 0);
+
+	{
+		threading::thread_group threads;
+		threads.spawn(1, [&]() { p.consume_loop_or_wait([](uint64_t&&) {}); });
+		while (p.stats().sleeping_consumers == 0)
+			std::this_thread::yield();
+
+		TEST_ASSERT(p.push_back(1));
+		TEST_ASSERT(p.stats().wakeups == 1);
+		p.wait_for_empty();
+		p.close();
+	}
+	TEST_ASSERT(p.push_back(1) == false);
+
+	st = p.stats();
+	TEST_ASSERT(st.pushed == 11 && st.consumed == 11 && st.rejected == 1);
+	TEST_ASSERT(st.sleeping_consumers == 0 && st.polling_consumers == 0);
+}
+
 void test_async_pipe()
 {
 	TEST_FUNCTION(test_async_pipe1);
 	TEST_FUNCTION(test_async_pipe2);
 	TEST_FUNCTION(test_async_pipe3);
+	TEST_FUNCTION(test_async_pipe_close_drain);
+	TEST_FUNCTION(test_async_pipe_close_drop);
+	TEST_FUNCTION(test_async_pipe_priority);
+	TEST_FUNCTION(test_async_pipe_spin);
+	TEST_FUNCTION(test_async_pipe_spin_forever);
+	TEST_FUNCTION(test_async_pipe_stats);
 }
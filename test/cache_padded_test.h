@@ -0,0 +1,164 @@
+#include <threading.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+void test_cache_padded_layout()
+{
+	static_assert(sizeof(threading::cache_padded<char>) == threading::hardware_destructive_interference_size, "one line");
+	static_assert(alignof(threading::cache_padded<char>) == threading::hardware_destructive_interference_size, "line aligned");
+
+	threading::cache_padded<std::atomic<uint32_t>> cells[2] { threading::cache_padded<std::atomic<uint32_t>>(1),
+		threading::cache_padded<std::atomic<uint32_t>>(2) };
+	TEST_ASSERT(cells[0]->load() == 1);
+	TEST_ASSERT((*cells[1]).load() == 2);
+	TEST_ASSERT(reinterpret_cast<uintptr_t>(&cells[1]) - reinterpret_cast<uintptr_t>(&cells[0]) ==
+				threading::hardware_destructive_interference_size);
+}
+
+template <class CELL, class F>
+// each thread increments its own cell, returns the run time in ms
+inline double cache_padded_bench_run(const std::size_t thread_count, const uint64_t iterations, const F& _get)
+{
+	std::vector<CELL> cells(thread_count);
+	threading::latch  start(thread_count + 1);
+
+	auto begin = std::chrono::steady_clock::now();
+	{
+		threading::thread_group threads;
+		std::atomic<std::size_t> index { 0 };
+		threads.spawn(thread_count, [&]() {
+			std::atomic<uint64_t>& c = _get(cells[index++]);
+			start.arrive_and_wait();
+			for (uint64_t i = 0; i < iterations; i++)
+				c.fetch_add(1, std::memory_order_relaxed);
+		});
+		start.arrive_and_wait();
+		begin = std::chrono::steady_clock::now();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	for (auto& c : cells)
+		TEST_ASSERT(_get(c).load() == iterations);
+	return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+// benchmark: neighbouring counters written by different threads, packed vs one per cache line
+void test_cache_padded_bench()
+{
+	struct packed_cell
+	{
+		std::atomic<uint64_t> value { 0 };
+	};
+	using padded_cell = threading::cache_padded<std::atomic<uint64_t>>;
+
+	const std::size_t thread_count = std::max<std::size_t>(2, std::min<std::size_t>(8, std::thread::hardware_concurrency()));
+	const uint64_t	  iterations = 2000000;
+
+	double packed = cache_padded_bench_run<packed_cell>(thread_count, iterations, [](packed_cell& c) -> std::atomic<uint64_t>& { return c.value; });
+	double padded = cache_padded_bench_run<padded_cell>(thread_count, iterations, [](padded_cell& c) -> std::atomic<uint64_t>& { return *c; });
+
+	std::cout << "\n" << thread_count << " threads x " << iterations << " increments: packed " << packed << " ms, padded " << padded << " ms\n";
+}
+
+inline double cache_padded_elapsed_ms(const std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// benchmark: the primitives whose hot members are padded, build with THREADING_PACKED_LAYOUT for the unpadded numbers
+void test_cache_padded_primitives_bench()
+{
+#if defined(THREADING_PACKED_LAYOUT)
+	const char* layout = "packed";
+#else
+	const char* layout = "padded";
+#endif
+	const std::size_t thread_count = std::max<std::size_t>(2, std::min<std::size_t>(8, std::thread::hardware_concurrency()));
+	const std::size_t producer_count = std::max<std::size_t>(1, thread_count / 2);
+	const std::size_t consumer_count = std::max<std::size_t>(1, thread_count - producer_count);
+
+	// contended pipe: producers fight for m_first_lock while consumers drain it
+	const uint64_t item_count = 200000;
+	double		   pipe_ms = 0.0;
+	{
+		threading::async_pipe<uint64_t> p;
+		std::atomic<uint64_t>			sum { 0 };
+		threading::latch				start(producer_count + consumer_count + 1);
+
+		auto begin = std::chrono::steady_clock::now();
+		{
+			threading::thread_group consumers;
+			consumers.spawn(consumer_count, [&]() {
+				start.arrive_and_wait();
+				uint64_t local = 0;
+				p.consume_loop_or_wait([&](const uint64_t value) { local += value; });
+				sum += local;
+			});
+			{
+				threading::thread_group producers;
+				producers.spawn(producer_count, [&]() {
+					start.arrive_and_wait();
+					for (uint64_t i = 0; i < item_count / producer_count; i++)
+						p.push_back(1);
+				});
+				start.arrive_and_wait();
+				begin = std::chrono::steady_clock::now();
+			}
+			p.close_and_wait(threading::close_policy::drain);
+		}
+		pipe_ms = cache_padded_elapsed_ms(begin);
+		TEST_ASSERT(sum.load() == item_count / producer_count * producer_count);
+	}
+
+	// a fresh latch per round, every thread arrives on each
+	const std::size_t latch_rounds = 2000;
+	double			  latch_ms = 0.0;
+	{
+		std::vector<std::unique_ptr<threading::latch>> latches;
+		for (std::size_t i = 0; i < latch_rounds; i++)
+			latches.emplace_back(new threading::latch(thread_count));
+
+		auto begin = std::chrono::steady_clock::now();
+		{
+			threading::thread_group threads;
+			threads.spawn(thread_count, [&]() {
+				for (auto& l : latches)
+					l->arrive_and_wait();
+			});
+		}
+		latch_ms = cache_padded_elapsed_ms(begin);
+	}
+
+	// one barrier reused for every round
+	const uint32_t barrier_rounds = 2000;
+	double		   barrier_ms = 0.0;
+	{
+		threading::barrier b { uint32_t(thread_count) };
+		std::atomic<uint64_t> passed { 0 };
+
+		auto begin = std::chrono::steady_clock::now();
+		{
+			threading::thread_group threads;
+			threads.spawn(thread_count, [&]() {
+				for (uint32_t i = 0; i < barrier_rounds; i++)
+					b.arrive_and_wait();
+				passed++;
+			});
+		}
+		barrier_ms = cache_padded_elapsed_ms(begin);
+		TEST_ASSERT(passed.load() == thread_count);
+	}
+
+	std::cout << "\n" << layout << " layout, " << thread_count << " threads: async_pipe " << producer_count << "p/" << consumer_count << "c x " << item_count
+			  << " items " << pipe_ms << " ms, " << latch_rounds << " latches " << latch_ms << " ms, " << barrier_rounds << " barrier rounds " << barrier_ms
+			  << " ms\n";
+}
+
+void test_cache_padded()
+{
+	TEST_FUNCTION(test_cache_padded_layout);
+	TEST_FUNCTION(test_cache_padded_bench);
+	TEST_FUNCTION(test_cache_padded_primitives_bench);
+}
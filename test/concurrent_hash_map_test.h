@@ -0,0 +1,95 @@
+#include <threading.h>
+
+#include <iostream>
+#include <string>
+
+void test_concurrent_hash_map()
+{
+	{
+		// single thread, several resizes
+		threading::concurrent_hash_map<uint32_t, uint64_t> map;
+		const std::size_t								   initial_buckets = map.bucket_count();
+		for (uint32_t i = 0; i < 10000; i++)
+			TEST_ASSERT(map.insert_or_assign(i, uint64_t(i) * 3));
+		TEST_ASSERT(map.size() == 10000);
+		TEST_ASSERT(map.bucket_count() > initial_buckets);
+
+		TEST_ASSERT(map.insert_or_assign(5u, uint64_t(7)) == false);
+		uint64_t v = 0;
+		TEST_ASSERT(map.find(5u, v) && v == 7);
+		TEST_ASSERT(map.visit(5u, [](uint64_t& value) { value++; }));
+		TEST_ASSERT(map.find(5u, v) && v == 8);
+		TEST_ASSERT(map.visit(20000u, [](uint64_t&) {}) == false);
+
+		for (uint32_t i = 0; i < 10000; i += 2)
+			TEST_ASSERT(map.erase(i));
+		TEST_ASSERT(map.erase(0u) == false);
+		TEST_ASSERT(map.size() == 5000);
+		for (uint32_t i = 0; i < 10000; i++)
+			TEST_ASSERT(map.contains(i) == (i % 2 == 1));
+
+		uint64_t sum = 0;
+		std::size_t count = 0;
+		map.for_each([&](const uint32_t&, uint64_t& value) {
+			sum += value;
+			count++;
+		});
+		TEST_ASSERT(count == 5000);
+	}
+
+	{
+		// non trivially copyable values take the locked lookup
+		threading::concurrent_hash_map<std::string, std::string> map;
+		for (int i = 0; i < 1000; i++)
+			map.insert_or_assign(std::to_string(i), "v" + std::to_string(i));
+		std::string v;
+		TEST_ASSERT(map.find("500", v) && v == "v500");
+		TEST_ASSERT(map.find("x", v) == false);
+		TEST_ASSERT(map.erase("500") && map.size() == 999);
+	}
+
+	{
+		// writers on disjoint key ranges while readers look up values that must always be consistent with their key
+		threading::concurrent_hash_map<uint32_t, uint64_t> map(64);
+		const uint32_t									   writer_count = 3;
+		const uint32_t									   keys_per_writer = 4000;
+		std::atomic<uint32_t>							   writers_done { 0 };
+		std::atomic<bool>								   bad { false };
+
+		{
+			threading::thread_group threads;
+			std::atomic<uint32_t>	next { 0 };
+			threads.spawn(writer_count, [&]() {
+				const uint32_t base = next++ * keys_per_writer;
+				for (uint32_t i = 0; i < keys_per_writer; i++)
+					map.insert_or_assign(base + i, uint64_t(base + i) << 32);
+				for (uint32_t i = 0; i < keys_per_writer; i += 4)
+					map.erase(base + i);
+				for (uint32_t i = 1; i < keys_per_writer; i += 4)
+					map.insert_or_assign(base + i, (uint64_t(base + i) << 32) | 1);
+				writers_done++;
+			});
+			threads.spawn(1, [&]() {
+				uint32_t k = 0;
+				while (writers_done.load() < writer_count)
+				{
+					uint64_t v;
+					if (map.find(k, v) && (v >> 32) != k)
+						bad = true;
+					k = (k + 7) % (writer_count * keys_per_writer);
+				}
+			});
+		}
+
+		TEST_ASSERT(bad == false);
+		TEST_ASSERT(map.size() == writer_count * keys_per_writer * 3 / 4);
+		for (uint32_t k = 0; k < writer_count * keys_per_writer; k++)
+		{
+			uint64_t v = 0;
+			bool	 found = map.find(k, v);
+			TEST_ASSERT(found == (k % 4 != 0));
+			if (found)
+				TEST_ASSERT(v == ((uint64_t(k) << 32) | (k % 4 == 1 ? 1 : 0)));
+		}
+	}
+}
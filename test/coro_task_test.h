@@ -0,0 +1,120 @@
+#include <threading.h>
+
+#include <iostream>
+
+#if defined(THREADING_COROUTINES)
+
+threading::task<uint64_t> coro_add(const uint64_t a, const uint64_t b)
+{
+	co_return a + b;
+}
+
+threading::task<uint64_t> coro_chain()
+{
+	uint64_t r = co_await coro_add(1, 2);
+	r += co_await coro_add(r, 4);
+	co_return r;
+}
+
+void test_coro_task_chain()
+{
+	TEST_ASSERT(threading::sync_wait(coro_chain()) == 10);
+}
+
+void test_coro_async_pipe()
+{
+	threading::worker_pool			pool(2);
+	threading::async_pipe<uint64_t> p;
+
+	const std::size_t	  waiters = 20000;
+	std::atomic<uint64_t> sum { 0 };
+	threading::latch	  done(waiters + 1);
+
+	auto consumer = [&]() -> threading::task<void> {
+		std::optional<uint64_t> v = co_await p.pop();
+		TEST_ASSERT(v.has_value());
+		sum += *v;
+		co_await done;
+	};
+
+	for (std::size_t i = 0; i < waiters; i++)
+		threading::spawn(pool, consumer());
+
+	for (uint64_t i = 0; i < waiters; i++)
+		p.push_back(i);
+
+	done.arrive_and_wait();
+	TEST_ASSERT(sum.load() == uint64_t(waiters) * (waiters - 1) / 2);
+
+}
+
+void test_coro_async_pipe_evict()
+{
+	threading::async_pipe<uint64_t> p;
+	threading::thread_group			threads;
+
+	struct evict_node : public threading::async_pipe<uint64_t>::async_consumer
+	{
+		bool resumed = false;
+	};
+
+	// evict resumes the queued async consumers with an empty item
+	std::array<evict_node, 4> nodes;
+	for (auto& n : nodes)
+	{
+		n.resume = [](threading::async_waiter* w) { static_cast<evict_node*>(w)->resumed = true; };
+		TEST_ASSERT(p.pop_async(n) == false);
+	}
+
+	threads.spawn(1, [&]() { p.consume_loop_or_wait([](uint64_t) {}); });
+	p.evict(threads.size(), 0);
+
+	for (auto& n : nodes)
+	{
+		TEST_ASSERT(n.resumed);
+		TEST_ASSERT(n.item.has_value() == false);
+	}
+}
+
+void test_coro_semaphore()
+{
+	threading::worker_pool pool(4);
+	threading::semaphore   sem(2);
+
+	std::atomic<int32_t>  inside { 0 };
+	std::atomic<uint32_t> finished { 0 };
+	const uint32_t		  count = 1000;
+
+	threading::latch done(count + 1);
+	auto			 worker = [&]() -> threading::task<void> {
+		co_await threading::acquire(sem);
+		TEST_ASSERT(inside.fetch_add(1) < 2);
+		co_await threading::schedule_on(pool);
+		inside--;
+		sem.release();
+		finished++;
+		co_await done;
+	};
+
+	for (uint32_t i = 0; i < count; i++)
+		threading::spawn(pool, worker());
+
+	done.arrive_and_wait();
+	TEST_ASSERT(finished.load() == count);
+}
+
+void test_coro_task()
+{
+	TEST_FUNCTION(test_coro_task_chain);
+	TEST_FUNCTION(test_coro_async_pipe);
+	TEST_FUNCTION(test_coro_async_pipe_evict);
+	TEST_FUNCTION(test_coro_semaphore);
+}
+
+#else
+
+void test_coro_task()
+{
+}
+
+#endif
@@ -0,0 +1,83 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_elastic_consumers_grow()
+{
+	using namespace std::chrono_literals;
+
+	threading::async_pipe<uint64_t> p;
+	std::atomic<uint64_t>			sum { 0 };
+	{
+		threading::elastic_consumers<threading::async_pipe<uint64_t>> pool(p, 1, 4, 8, 20ms, [&](uint64_t&& value) {
+			std::this_thread::sleep_for(20us);
+			sum += value;
+		});
+		TEST_ASSERT(pool.size() == 1);
+
+		// a backlog makes the pool grow
+		const uint64_t vc = 2000;
+		for (uint64_t i = 0; i < vc; i++)
+			TEST_ASSERT(p.push_back(1));
+		p.wait_for_empty();
+		TEST_ASSERT(sum.load() == vc);
+		TEST_ASSERT(pool.peak_size() > 1 && pool.peak_size() <= 4);
+
+		// idle consumers retire down to the minimum
+		for (uint32_t i = 0; i < 200 && pool.size() > 1; i++)
+			std::this_thread::sleep_for(10ms);
+		TEST_ASSERT(pool.size() == 1);
+
+		// and the pool keeps working with what is left
+		TEST_ASSERT(p.push_back(5));
+		p.wait_for_empty();
+		TEST_ASSERT(sum.load() == vc + 5);
+	}
+	// the pipe outlives the pool and takes new consumers
+	TEST_ASSERT(p.push_back(1));
+	TEST_ASSERT(p.consume_loop([&](uint64_t&& value) { sum += value; }));
+	TEST_ASSERT(sum.load() == 2006);
+}
+
+// pools that grow, retire and get destroyed at any point; the pool never drops below min_threads
+void test_elastic_consumers_churn()
+{
+	using namespace std::chrono_literals;
+
+	threading::async_pipe<uint64_t> p;
+	std::atomic<uint64_t>			sum { 0 };
+	uint64_t						pushed = 0;
+	for (uint32_t round = 0; round < 200; round++)
+	{
+		threading::elastic_consumers<threading::async_pipe<uint64_t>> pool(p, 1, 4, 2, 1ms, [&](uint64_t&& value) { sum += value; });
+
+		for (uint32_t i = 0; i < 64; i++)
+		{
+			TEST_ASSERT(p.push_back(1));
+			pushed++;
+		}
+		// let some consumers time out together
+		if (round % 4 == 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(500 + round * 20));
+		TEST_ASSERT(pool.size() >= 1);
+
+		// whatever is left keeps consuming
+		if (round % 16 == 0)
+		{
+			TEST_ASSERT(p.push_back(1));
+			pushed++;
+			for (uint32_t i = 0; i < 1000 && p.depth() > 0; i++)
+				std::this_thread::sleep_for(1ms);
+			TEST_ASSERT(p.depth() == 0);
+			TEST_ASSERT(pool.size() >= 1);
+		}
+	}
+	TEST_ASSERT(p.consume_loop([&](uint64_t&& value) { sum += value; }));
+	TEST_ASSERT(sum.load() == pushed);
+}
+
+void test_elastic_consumers()
+{
+	TEST_FUNCTION(test_elastic_consumers_grow);
+	TEST_FUNCTION(test_elastic_consumers_churn);
+}
@@ -0,0 +1,55 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_event_count()
+{
+	threading::event_count ec;
+
+	// no waiters: notify only looks at the state
+	ec.notify_one();
+	ec.notify_all();
+
+	// a key taken before a notification does not block
+	{
+		auto key = ec.prepare_wait();
+		ec.notify_one();
+		ec.commit_wait(key);
+	}
+
+	// consumers sleep on a lock-free counter that producers raise
+	{
+		const uint32_t		  producer_count = 3;
+		const uint32_t		  per_producer = 20000;
+		std::atomic<uint32_t> produced { 0 };
+		std::atomic<uint32_t> consumed { 0 };
+
+		threading::thread_group threads;
+		threads.spawn(2, [&]() {
+			while (true)
+			{
+				uint32_t c = consumed.load();
+				if (c == producer_count * per_producer)
+					return;
+				if (c < produced.load())
+				{
+					if (consumed.compare_exchange_weak(c, c + 1) && c + 1 == producer_count * per_producer)
+						ec.notify_all(); // the other consumer may sleep
+					continue;
+				}
+				auto key = ec.prepare_wait();
+				if (consumed.load() < produced.load() || consumed.load() == producer_count * per_producer)
+					ec.cancel_wait();
+				else
+					ec.commit_wait(key);
+			}
+		});
+		threads.spawn(producer_count, [&]() {
+			for (uint32_t i = 0; i < per_producer; i++)
+			{
+				produced++;
+				ec.notify_one();
+			}
+		});
+	}
+}
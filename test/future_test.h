@@ -0,0 +1,159 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_future_then()
+{
+	threading::worker_pool pool(4);
+
+	{
+		threading::promise<uint32_t> p;
+		auto						 f = p.get_future()
+				 .then([](const uint32_t v) { return uint64_t(v) * 2; })
+				 .then(pool, [](const uint64_t v) { return v + 1; })
+				 .then([](const uint64_t v) { TEST_ASSERT(v == 85); });
+		TEST_ASSERT(f.ready() == false);
+		p.set_value(42);
+		f.get();
+	}
+	{
+		// value set before the continuation is attached
+		auto f = threading::make_ready_future<uint32_t>(7).then([](const uint32_t v) { return v + 1; });
+		TEST_ASSERT(f.ready());
+		TEST_ASSERT(f.get() == 8);
+	}
+	{
+		threading::promise<uint32_t> p;
+		auto						 f = p.get_future();
+		threading::thread_group		 threads;
+		threads.spawn(1, [&]() {
+			threading::utils::sleep_thread(5);
+			p.set_value(3);
+		});
+		TEST_ASSERT(f.get() == 3);
+	}
+}
+
+void test_future_when_all_any()
+{
+	threading::worker_pool pool(4);
+
+	const std::size_t						  count = 64;
+	std::vector<threading::promise<uint64_t>> promises(count);
+	std::vector<threading::future<uint64_t>>  all;
+	for (std::size_t i = 0; i < count; i++)
+		all.push_back(promises[i].get_future().then(pool, [](const uint64_t v) { return v * 2; }));
+
+	auto f_all = threading::when_all(std::move(all));
+	for (std::size_t i = 0; i < count; i++)
+		pool.submit([&promises, i]() { promises[i].set_value(i); });
+
+	std::vector<uint64_t> values = f_all.get();
+	TEST_ASSERT(values.size() == count);
+	for (std::size_t i = 0; i < count; i++)
+		TEST_ASSERT(values[i] == i * 2);
+
+	std::vector<threading::promise<void>> void_promises(3);
+	std::vector<threading::future<void>>  void_futures;
+	for (auto& p : void_promises)
+		void_futures.push_back(p.get_future());
+	auto f_any = threading::when_any(std::move(void_futures));
+	void_promises[1].set_value();
+	TEST_ASSERT(f_any.get() == 1);
+	void_promises[0].set_value();
+	void_promises[2].set_value();
+}
+
+void test_future_broken_promise()
+{
+	{
+		threading::future<uint32_t> f;
+		{
+			threading::promise<uint32_t> p;
+			f = p.get_future();
+		}
+		TEST_ASSERT(f.ready());
+		TEST_ASSERT(f.broken());
+		f.wait();
+	}
+	{
+		// continuations are skipped and break their own futures
+		bool					ran = false;
+		threading::future<void> chained;
+		{
+			threading::promise<uint32_t> p;
+			chained = p.get_future().then([&ran](const uint32_t) { ran = true; });
+			TEST_ASSERT(chained.ready() == false);
+		}
+		TEST_ASSERT(chained.broken());
+		TEST_ASSERT(ran == false);
+	}
+	{
+		// a waiter on another thread wakes up
+		auto						p = std::make_unique<threading::promise<uint32_t>>();
+		threading::future<uint32_t> f = p->get_future();
+		std::atomic<bool>			broken { false };
+		{
+			threading::thread_group waiter;
+			waiter.spawn(1, [&]() {
+				f.wait();
+				broken = f.broken();
+			});
+			threading::utils::sleep_thread(5);
+			p.reset();
+		}
+		TEST_ASSERT(broken.load());
+	}
+	{
+		// when_all over a broken input breaks as well
+		std::vector<threading::promise<uint64_t>> promises(2);
+		std::vector<threading::future<uint64_t>>  all;
+		for (auto& p : promises)
+			all.push_back(p.get_future());
+		auto f_all = threading::when_all(std::move(all));
+		promises[0].set_value(1);
+		promises.clear();
+		TEST_ASSERT(f_all.broken());
+	}
+}
+
+// promises made on one thread and completed and freed on another: the states go back to the producer's pool cache
+void test_future_state_round_trip()
+{
+	using blocks = threading::detail::block_pool<sizeof(threading::detail::future_state<uint64_t>)>;
+
+	auto run = [](const uint64_t count) {
+		threading::spsc_queue<std::unique_ptr<threading::promise<uint64_t>>> q(64);
+		uint64_t															  sum = 0;
+		{
+			threading::thread_group consumer;
+			consumer.spawn(1, [&]() {
+				std::unique_ptr<threading::promise<uint64_t>> p;
+				while (q.pop(p))
+					p->set_value(1);
+			});
+			for (uint64_t i = 0; i < count; i++)
+			{
+				auto p = std::make_unique<threading::promise<uint64_t>>();
+				p->get_future().then([&sum](const uint64_t v) { sum += v; });
+				q.push(std::move(p));
+			}
+			q.close();
+		}
+		TEST_ASSERT(sum == count);
+	};
+
+	run(1000);
+	const std::size_t slabs = blocks::pool().slab_count();
+	run(50000);
+	const std::size_t in_flight = 64 + threading::object_pool_base::remote_batch + 4;
+	TEST_ASSERT(blocks::pool().slab_count() - slabs <= in_flight / 64 + 1);
+}
+
+void test_future()
+{
+	TEST_FUNCTION(test_future_then);
+	TEST_FUNCTION(test_future_when_all_any);
+	TEST_FUNCTION(test_future_broken_promise);
+	TEST_FUNCTION(test_future_state_round_trip);
+}
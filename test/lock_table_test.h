@@ -0,0 +1,51 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_lock_table()
+{
+	threading::lock_table<64> locks(0); // the stripe values count writes
+
+	const std::size_t	  account_count = 1000;
+	std::vector<int64_t> balance(account_count, 100);
+
+	{
+		auto g = locks.lock(std::size_t(7));
+		TEST_ASSERT(g.stripe() == locks.stripe_of(std::size_t(7)));
+		TEST_ASSERT(locks.stripe_lock(g.stripe()).islocked());
+	}
+
+	{
+		threading::thread_group threads;
+		std::atomic<uint32_t>	seed { 1 };
+		threads.spawn(4, [&]() {
+			uint32_t s = seed++;
+			for (uint32_t i = 0; i < 5000; i++)
+			{
+				s = s * 1103515245 + 12345;
+				std::size_t from = (s >> 8) % account_count;
+				s = s * 1103515245 + 12345;
+				std::size_t to = (s >> 8) % account_count;
+
+				auto g = locks.lock_many(from, to); // same or colliding stripes are locked once
+				TEST_ASSERT(g.size() == (locks.stripe_of(from) == locks.stripe_of(to) ? 1u : 2u));
+				balance[from] -= 1;
+				balance[to] += 1;
+				g.value_of(locks.stripe_of(from))++;
+			}
+		});
+	}
+
+	int64_t total = 0;
+	for (int64_t b : balance)
+		total += b;
+	TEST_ASSERT(total == int64_t(account_count * 100));
+
+	uint64_t writes = 0;
+	for (std::size_t i = 0; i < locks.stripe_count; i++)
+	{
+		TEST_ASSERT(locks.stripe_lock(i).islocked() == false);
+		writes += locks.stripe_lock(i).peek();
+	}
+	TEST_ASSERT(writes == 4 * 5000);
+}
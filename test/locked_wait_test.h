@@ -0,0 +1,49 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_locked_wait()
+{
+	threading::locked_wait lw;
+	threading::spin_lock   root;
+	std::mutex			   wait_lock;
+
+	std::vector<uint32_t> woken;
+	std::atomic<uint32_t> sleeping { 0 };
+	{
+		threading::thread_group threads;
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			threads.spawn(1, [&, i]() {
+				std::lock_guard<threading::spin_lock> _(root);
+				sleeping++;
+				lw.wait(root, wait_lock);
+				woken.push_back(i);
+			});
+			// once the root lock is free again the thread is on the sleeper stack
+			while (sleeping.load() == i)
+				std::this_thread::yield();
+			std::lock_guard<threading::spin_lock> _(root);
+		}
+
+		// the last one to go to sleep is woken first
+		for (std::size_t n = 1; n <= 2; n++)
+		{
+			{
+				std::lock_guard<threading::spin_lock> _(root);
+				TEST_ASSERT(lw.awake_one(wait_lock));
+			}
+			while (true)
+			{
+				std::lock_guard<threading::spin_lock> _(root);
+				if (woken.size() == n)
+					break;
+			}
+		}
+		std::lock_guard<threading::spin_lock> _(root);
+		TEST_ASSERT(lw.awake_all(wait_lock) == 1);
+		TEST_ASSERT(lw.awake_one(wait_lock) == false);
+	}
+	TEST_ASSERT(woken.size() == 3);
+	TEST_ASSERT(woken[0] == 2 && woken[1] == 1 && woken[2] == 0);
+}
@@ -0,0 +1,57 @@
+#include "../bench/memory_bench.h"
+
+#include <iostream>
+#include <sstream>
+
+void test_memory_bench_parse()
+{
+	std::vector<std::size_t> sizes;
+	TEST_ASSERT(memory_bench::parse("4096,32K,8M,1G", sizes));
+	TEST_ASSERT(sizes.size() == 4 && sizes[0] == 4096 && sizes[1] == 32 * 1024 && sizes[2] == 8 * 1024 * 1024 && sizes[3] == std::size_t(1) << 30);
+	TEST_ASSERT(memory_bench::parse("32X", sizes) == false);
+	TEST_ASSERT(memory_bench::parse("", sizes) == false);
+
+	std::vector<memory_bench::pattern> patterns;
+	TEST_ASSERT(memory_bench::parse("random_chase,sequential", patterns));
+	TEST_ASSERT(patterns.size() == 2 && patterns[0] == memory_bench::pattern::random_chase);
+	TEST_ASSERT(memory_bench::parse("random", patterns) == false);
+
+	memory_bench::config c;
+	c.cpus = 8;
+	TEST_ASSERT(c.cpu_for(memory_bench::pinning::none, 3, 4) == -1);
+	TEST_ASSERT(c.cpu_for(memory_bench::pinning::compact, 3, 4) == 3);
+	TEST_ASSERT(c.cpu_for(memory_bench::pinning::spread, 3, 4) == 6);
+	TEST_ASSERT(c.cpu_for(memory_bench::pinning::compact, 9, 16) == 1);
+}
+
+// a small sweep; the benchmark itself is bench/memory_bench_main.cpp
+void test_memory_bench_run()
+{
+	memory_bench::config c;
+	c.threads = { 1, 2 };
+	c.working_sets = { 32 << 10, 4 << 20 };
+	c.pinnings = { memory_bench::pinning::none, memory_bench::pinning::compact };
+	c.duration = std::chrono::milliseconds(10);
+
+	std::cout << "\n";
+	memory_bench::write_table_header(std::cout);
+	const std::vector<memory_bench::result> results = memory_bench::run(c, [](const memory_bench::result& r) { memory_bench::write_table_row(std::cout, r); });
+	TEST_ASSERT(results.size() == c.threads.size() * c.working_sets.size() * c.patterns.size() * c.pinnings.size());
+	for (const memory_bench::result& r : results)
+	{
+		TEST_ASSERT(r.accesses > 0);
+		TEST_ASSERT(r.seconds >= 0.01);
+		TEST_ASSERT(r.ns_per_access > 0.0 && r.gb_per_s > 0.0);
+	}
+
+	std::ostringstream json;
+	memory_bench::write_json(json, c, results);
+	TEST_ASSERT(json.str().find("{\n\"host\":{\"cpus\":") == 0);
+	TEST_ASSERT(json.str().find("\"pattern\":\"random_chase\",\"pinning\":\"compact\"") != std::string::npos);
+}
+
+void test_memory_bench()
+{
+	TEST_FUNCTION(test_memory_bench_parse);
+	TEST_FUNCTION(test_memory_bench_run);
+}
@@ -0,0 +1,136 @@
+#include <threading.h>
+
+#include <iostream>
+
+struct pooled_item
+{
+	static std::atomic<int64_t> alive;
+
+	uint64_t value;
+	uint64_t payload[3];
+
+	explicit pooled_item(const uint64_t v)
+		: value(v)
+	{
+		alive++;
+	}
+	~pooled_item()
+	{
+		alive--;
+	}
+};
+inline std::atomic<int64_t> pooled_item::alive { 0 };
+
+void test_object_pool_local()
+{
+	threading::object_pool<pooled_item> pool;
+
+	pooled_item* a = pool.create(1);
+	TEST_ASSERT(a->value == 1);
+	TEST_ASSERT(reinterpret_cast<uintptr_t>(a) % alignof(pooled_item) == 0);
+	pool.destroy(a);
+	TEST_ASSERT(pooled_item::alive.load() == 0);
+
+	// freed on the owning thread, handed out again first
+	pooled_item* b = pool.create(2);
+	TEST_ASSERT(a == b);
+	pool.destroy(b);
+
+	std::vector<threading::pooled_ptr<pooled_item>> items;
+	for (uint64_t i = 0; i < 1000; i++)
+		items.push_back(pool.make(i));
+	TEST_ASSERT(pooled_item::alive.load() == 1000);
+	for (uint64_t i = 0; i < 1000; i++)
+		TEST_ASSERT(items[i]->value == i);
+	items.clear();
+	TEST_ASSERT(pooled_item::alive.load() == 0);
+
+	// the cache of an exited thread is taken over by the next thread
+	{
+		threading::object_pool<uint64_t> other;
+		uint64_t*						 first = nullptr;
+		std::thread([&]() {
+			first = other.create(1);
+			other.destroy(first);
+		}).join();
+		std::thread([&]() {
+			uint64_t* second = other.create(2);
+			TEST_ASSERT(second == first);
+			other.destroy(second);
+		}).join();
+	}
+}
+
+void test_object_pool_pipe()
+{
+	std::atomic<uint64_t> sum { 0 };
+	std::atomic<uint64_t> count { 0 };
+	{
+		threading::pooled_async_pipe<pooled_item> p;
+
+		threading::thread_group consumers;
+		consumers.spawn(4, [&]() {
+			p.consume_loop_or_wait([&](threading::pooled_ptr<pooled_item>&& item) {
+				sum += item->value;
+				count++;
+			});
+		});
+
+		{
+			threading::thread_group producers;
+			producers.spawn(4, [&]() {
+				for (uint64_t i = 1; i <= 10000; i++)
+					p.emplace_back(i);
+			});
+		}
+
+		p.close_and_wait();
+	}
+	TEST_ASSERT(count.load() == 40000);
+	TEST_ASSERT(sum.load() == 4 * (10000ull * 10001 / 2));
+	TEST_ASSERT(pooled_item::alive.load() == 0);
+}
+
+// thread_locals destroyed after their thread released its pool caches free through the remote path
+void test_object_pool_thread_exit()
+{
+	struct late_user
+	{
+		threading::object_pool<pooled_item>* pool = nullptr;
+		threading::pooled_ptr<pooled_item>	 held;
+
+		~late_user()
+		{
+			if (pool == nullptr)
+				return;
+			held.reset();
+			pool->destroy(pool->create(2)); // borrows a cache for the one allocation
+		}
+	};
+
+	threading::object_pool<pooled_item> pool;
+	std::thread([&]() {
+		static thread_local late_user user; // constructed before the pool caches of this thread, so destroyed after them
+		user.pool = &pool;
+		user.held = pool.make(1);
+	}).join();
+	TEST_ASSERT(pooled_item::alive.load() == 0);
+
+	// the next thread takes the released cache over and gets every node back, without a second slab
+	std::thread([&]() {
+		std::vector<pooled_item*> items;
+		for (uint64_t i = 0; i < 64; i++)
+			items.push_back(pool.create(i));
+		TEST_ASSERT(pool.slab_count() == 1);
+		for (pooled_item* item : items)
+			pool.destroy(item);
+	}).join();
+	TEST_ASSERT(pooled_item::alive.load() == 0);
+}
+
+void test_object_pool()
+{
+	TEST_FUNCTION(test_object_pool_local);
+	TEST_FUNCTION(test_object_pool_pipe);
+	TEST_FUNCTION(test_object_pool_thread_exit);
+}
@@ -0,0 +1,82 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_parallel_for()
+{
+	threading::worker_pool pool(4);
+
+	std::vector<uint32_t> visits(100003, 0);
+	std::size_t			  grain = threading::cache_aligned_grain<uint32_t>(100);
+	TEST_ASSERT(grain % (threading::cache_line_size / sizeof(uint32_t)) == 0);
+
+	for (std::size_t run = 0; run < 4; run++)
+	{
+		threading::parallel_for(pool, 0, visits.size(), grain, [&](const std::size_t b, const std::size_t e) {
+			TEST_ASSERT(b < e);
+			TEST_ASSERT(e - b <= grain);
+			for (std::size_t i = b; i < e; i++)
+				visits[i]++;
+		});
+	}
+
+	for (auto v : visits)
+		TEST_ASSERT(v == 4);
+}
+
+void test_parallel_reduce()
+{
+	threading::worker_pool pool(4);
+
+	const std::size_t count = 1000000;
+	uint64_t		  sum = threading::parallel_reduce(
+		 pool, 0, count, 1024, uint64_t(0),
+		 [](const std::size_t b, const std::size_t e, const uint64_t init) {
+			 uint64_t r = init;
+			 for (std::size_t i = b; i < e; i++)
+				 r += i;
+			 return r;
+		 },
+		 [](const uint64_t a, const uint64_t b) { return a + b; });
+
+	TEST_ASSERT(sum == uint64_t(count) * (count - 1) / 2);
+}
+
+void test_parallel_scan()
+{
+	threading::worker_pool pool(4);
+
+	std::vector<uint64_t> in(77777);
+	std::vector<uint64_t> out(in.size());
+	for (std::size_t i = 0; i < in.size(); i++)
+		in[i] = i % 13;
+
+	uint64_t total = threading::parallel_scan(
+		pool, 0, in.size(), 256, uint64_t(0),
+		[&](const std::size_t b, const std::size_t e, const uint64_t prefix, const bool final_pass) {
+			uint64_t r = prefix;
+			for (std::size_t i = b; i < e; i++)
+			{
+				r += in[i];
+				if (final_pass)
+					out[i] = r;
+			}
+			return r;
+		},
+		[](const uint64_t a, const uint64_t b) { return a + b; });
+
+	uint64_t expected = 0;
+	for (std::size_t i = 0; i < in.size(); i++)
+	{
+		expected += in[i];
+		TEST_ASSERT(out[i] == expected);
+	}
+	TEST_ASSERT(total == expected);
+}
+
+void test_parallel_algorithms()
+{
+	TEST_FUNCTION(test_parallel_for);
+	TEST_FUNCTION(test_parallel_reduce);
+	TEST_FUNCTION(test_parallel_scan);
+}
@@ -0,0 +1,224 @@
+#include <threading.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+void test_perf_counters_basic()
+{
+	using threading::perf_event;
+
+	threading::perf_counters& counters = threading::perf_counters::this_thread();
+	std::cout << "\nperf counters:";
+	for (uint32_t e = 0; e < uint32_t(perf_event::count); e++)
+		std::cout << " " << threading::perf_counters::name(perf_event(e)) << (counters.has(perf_event(e)) ? "" : "(n/a)");
+	std::cout << std::endl;
+
+	threading::perf_sample s;
+	volatile uint64_t	   x = 0;
+	{
+		threading::perf_scope _(s);
+		for (uint64_t i = 0; i < 1000000; i++)
+			x = x + i;
+	}
+	TEST_ASSERT(s.samples == 1);
+	TEST_ASSERT((s.available & ~counters.read().available) == 0);
+	if (s.has(perf_event::instructions))
+		TEST_ASSERT(s[perf_event::instructions] >= 1000000);
+	if (s.has(perf_event::cycles) == false)
+		TEST_ASSERT(s.ipc() == 0.0);
+	TEST_ASSERT(s.per(perf_event::cycles, 0) == -1.0);
+
+	// an empty sample takes the counters of the first one added, later ones can only narrow them
+	threading::perf_sample a, b, sum;
+	a.available = 0x3;
+	a.samples = 1;
+	a.values[0] = 10;
+	b.available = 0x1;
+	b.samples = 1;
+	b.values[0] = 5;
+	sum += a;
+	TEST_ASSERT(sum.available == 0x3);
+	sum += b;
+	TEST_ASSERT(sum.available == 0x1 && sum.samples == 2 && sum[perf_event::cycles] == 15);
+
+	// deltas are scaled by the region's own running time, counters that went backwards give 0
+	threading::perf_sample begin, end;
+	begin.available = end.available = 0x1f;
+	begin.time_enabled = 1000;
+	begin.time_running = 1000;
+	begin.values[0] = 100;
+	begin.values[1] = 50;
+	end.time_enabled = 2000;
+	end.time_running = 1500;
+	end.values[0] = 300;
+	end.values[1] = 40;
+	threading::perf_sample d = threading::perf_counters::delta(begin, end);
+	TEST_ASSERT(d.time_enabled == 1000 && d.time_running == 500);
+	TEST_ASSERT(d[perf_event::cycles] == 400 && d[perf_event::instructions] == 0);
+
+	// a group that never ran in the region has nothing to scale
+	end.time_running = 1000;
+	d = threading::perf_counters::delta(begin, end);
+	TEST_ASSERT(d.available == 1u << uint32_t(perf_event::context_switches) && d[perf_event::cycles] == 0);
+}
+
+inline void perf_bench_print(const char* name, const uint64_t operations, const double ms, const threading::perf_sample& s)
+{
+	using threading::perf_event;
+
+	auto column = [&](const double v) {
+		if (v < 0.0)
+			std::cout << std::setw(10) << "-";
+		else
+			std::cout << std::setw(10) << v;
+	};
+
+	const auto flags = std::cout.flags();
+	std::cout << std::fixed << std::setprecision(2) << std::setw(18) << name;
+	column(ms * 1000000.0 / double(operations));
+	column(s.per(perf_event::cycles, operations));
+	column(s.has(perf_event::cycles) && s.has(perf_event::instructions) ? s.ipc() : -1.0);
+	column(s.per(perf_event::llc_misses, operations));
+	column(s.per(perf_event::cache_line_transfers, operations));
+	column(s.per(perf_event::context_switches, operations));
+	std::cout << std::endl;
+	std::cout.flags(flags);
+}
+
+template <class F>
+// runs _func(thread index) on thread_count threads started together, reports the counters of all of them per operation
+inline void perf_bench_run(const char* name, const std::size_t thread_count, const uint64_t operations, const F& _func)
+{
+	threading::perf_sample total;
+	std::mutex			   total_lock;
+	threading::latch	   start(thread_count + 1);
+
+	auto begin = std::chrono::steady_clock::now();
+	{
+		threading::thread_group	 threads;
+		std::atomic<std::size_t> index { 0 };
+		threads.spawn(thread_count, [&]() {
+			const std::size_t i = index++;
+			start.arrive_and_wait();
+			threading::perf_sample s;
+			{
+				threading::perf_scope _(s);
+				_func(i);
+			}
+			std::lock_guard<std::mutex> _(total_lock);
+			total += s;
+		});
+		start.arrive_and_wait();
+		begin = std::chrono::steady_clock::now();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	perf_bench_print(name, operations, std::chrono::duration<double, std::milli>(end - begin).count(), total);
+}
+
+// benchmark: what a contended operation costs and why, counters are summed over all threads
+void test_perf_counters_bench()
+{
+	const std::size_t thread_count = 4;
+	const uint64_t	  per_thread = 50000;
+	const uint64_t	  lock_ops = thread_count * per_thread;
+
+	std::cout << "\n" << std::setw(18) << "per operation" << std::setw(10) << "ns" << std::setw(10) << "cycles" << std::setw(10) << "ipc"
+			  << std::setw(10) << "llc miss" << std::setw(10) << "hitm" << std::setw(10) << "switches" << std::endl;
+
+	{
+		std::mutex m;
+		uint64_t   v = 0;
+		perf_bench_run("std::mutex", thread_count, lock_ops, [&](std::size_t) {
+			for (uint64_t i = 0; i < per_thread; i++)
+			{
+				std::lock_guard<std::mutex> _(m);
+				v++;
+			}
+		});
+		TEST_ASSERT(v == lock_ops);
+	}
+	{
+		threading::spin_lock m;
+		uint64_t			 v = 0;
+		perf_bench_run("spin_lock", thread_count, lock_ops, [&](std::size_t) {
+			for (uint64_t i = 0; i < per_thread; i++)
+			{
+				std::lock_guard<threading::spin_lock> _(m);
+				v++;
+			}
+		});
+		TEST_ASSERT(v == lock_ops);
+	}
+	{
+		threading::spin_value_lock<uint32_t> m(0);
+		perf_bench_run("spin_value_lock", thread_count, lock_ops, [&](std::size_t) {
+			for (uint64_t i = 0; i < per_thread; i++)
+				m.unlock(m.lock() + 1);
+		});
+		TEST_ASSERT(m.peek() == lock_ops);
+	}
+	{
+		threading::mr_spin_lock m;
+		uint64_t				v = 0;
+		// one writer, the others read
+		perf_bench_run("mr_spin_lock", thread_count, lock_ops, [&](const std::size_t i) {
+			for (uint64_t n = 0; n < per_thread; n++)
+			{
+				if (i == 0)
+				{
+					m.write_lock();
+					v++;
+					m.write_unlock();
+				}
+				else
+				{
+					std::lock_guard<threading::mr_spin_lock> _(m);
+					TEST_ASSERT(v <= per_thread);
+				}
+			}
+		});
+		TEST_ASSERT(v == per_thread);
+	}
+
+	const uint64_t items = 200000;
+	{
+		threading::spsc_queue<uint64_t> q(1024);
+		uint64_t						received = 0;
+		perf_bench_run("spsc_queue", 2, items, [&](const std::size_t i) {
+			if (i == 0)
+			{
+				for (uint64_t v = 0; v < items; v++)
+					q.push(v);
+				q.close();
+				return;
+			}
+			uint64_t v;
+			while (q.pop(v))
+				received++;
+		});
+		TEST_ASSERT(received == items);
+	}
+	{
+		threading::async_pipe<uint64_t> p;
+		std::atomic<uint64_t>			received { 0 };
+		perf_bench_run("async_pipe", 3, items, [&](const std::size_t i) {
+			if (i == 0)
+			{
+				for (uint64_t v = 0; v < items; v++)
+					p.push_back(v);
+				p.close();
+				return;
+			}
+			p.consume_loop_or_wait([&](uint64_t&&) { received.fetch_add(1, std::memory_order_relaxed); });
+		});
+		TEST_ASSERT(received.load() == items);
+	}
+}
+
+void test_perf_counters()
+{
+	TEST_FUNCTION(test_perf_counters_basic);
+	TEST_FUNCTION(test_perf_counters_bench);
+}
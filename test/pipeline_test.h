@@ -0,0 +1,86 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_pipeline_order()
+{
+	threading::worker_pool pool(4);
+
+	const uint64_t count = 5000;
+	const uint32_t max_tokens = 8;
+
+	struct item
+	{
+		uint64_t index;
+		uint64_t value;
+	};
+
+	uint64_t			  produced = 0;
+	std::atomic<uint32_t> in_flight { 0 };
+	std::atomic<uint32_t> max_in_flight { 0 };
+	std::atomic<uint32_t> unordered_inside { 0 };
+	std::atomic<uint32_t> ordered_inside { 0 };
+	uint64_t			  unordered_sum = 0;
+	std::vector<uint64_t> ordered;
+
+	threading::pipeline<item> p;
+	p.source([&](item& it) {
+		if (produced == count)
+			return false;
+		it.index = produced++;
+		uint32_t n = ++in_flight;
+		uint32_t m = max_in_flight.load();
+		while (n > m && max_in_flight.compare_exchange_weak(m, n) == false)
+		{
+		}
+		return true;
+	});
+	p.stage(threading::stage_mode::parallel, [](item& it) { it.value = it.index * it.index; });
+	p.stage(threading::stage_mode::serial_out_of_order, [&](item& it) {
+		TEST_ASSERT(unordered_inside.fetch_add(1) == 0);
+		unordered_sum += it.index;
+		unordered_inside--;
+	});
+	p.stage(threading::stage_mode::serial_in_order, [&](item& it) {
+		TEST_ASSERT(ordered_inside.fetch_add(1) == 0);
+		ordered.push_back(it.value);
+		ordered_inside--;
+		in_flight--;
+	});
+
+	for (uint32_t run = 0; run < 2; run++)
+	{
+		produced = 0;
+		unordered_sum = 0;
+		ordered.clear();
+
+		p.run(pool, max_tokens);
+
+		TEST_ASSERT(ordered.size() == count);
+		for (uint64_t i = 0; i < count; i++)
+			TEST_ASSERT(ordered[i] == i * i);
+		TEST_ASSERT(unordered_sum == count * (count - 1) / 2);
+		TEST_ASSERT(max_in_flight.load() <= max_tokens);
+	}
+}
+
+void test_pipeline_empty()
+{
+	threading::worker_pool pool(2);
+
+	uint32_t				  calls = 0;
+	threading::pipeline<int> p;
+	p.source([&](int&) {
+		calls++;
+		return false;
+	});
+	p.stage(threading::stage_mode::serial_in_order, [](int&) { TEST_ASSERT(false); });
+	p.run(pool, 4);
+	TEST_ASSERT(calls == 1);
+}
+
+void test_pipeline()
+{
+	TEST_FUNCTION(test_pipeline_order);
+	TEST_FUNCTION(test_pipeline_empty);
+}
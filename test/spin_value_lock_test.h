@@ -3,6 +3,41 @@
 
 #include <iostream>
 
+template <class T>
+// waiter_count lock_if() callers wait 300 ms for a value, three unlocks get there
+inline void spin_value_lock_if_wait(const uint32_t waiter_count)
+{
+	threading::spin_value_lock<T> spvalue(0);
+	const T						  target = 3;
+	std::atomic<uint64_t>		  waiters_cpu_ns { 0 };
+	std::atomic<uint64_t>		  predicate_calls { 0 };
+	std::atomic<uint32_t>		  done { 0 };
+	{
+		threading::thread_group waiters;
+		waiters.spawn(waiter_count, [&]() {
+			const uint64_t cpu_begin = threading::thread_group::current_thread_stats().cpu_time_ns;
+			const T		   value = spvalue.lock_if([&](const T value) {
+				   predicate_calls++;
+				   return value == target;
+			   });
+			waiters_cpu_ns += threading::thread_group::current_thread_stats().cpu_time_ns - cpu_begin;
+			done++;
+			spvalue.unlock(value);
+		});
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			threading::utils::sleep_thread(100);
+			TEST_ASSERT(done == 0);
+			spvalue.unlock(T(spvalue.lock() + 1));
+		}
+	}
+	TEST_ASSERT(done == waiter_count);
+	TEST_ASSERT(spvalue.peek() == target);
+	// spinning waiters burn the 300 ms, and waking each other would call the predicate without end
+	TEST_ASSERT(waiters_cpu_ns.load() < 50 * 1000 * 1000);
+	TEST_ASSERT(predicate_calls.load() < waiter_count * (threading::lock_spin_count + 1) * 4);
+}
+
 void test_spin_value_lock()
 {
 	std::array<std::thread, 32> threads;
@@ -32,4 +67,42 @@ void test_spin_value_lock()
 
 	TEST_ASSERT(spvalue.islocked() == false);
 	TEST_ASSERT(spvalue.peek() == uint32_t(expected));
+
+	// waiters that outlast the spin budget park, peek() included, and unlock() wakes them
+	{
+		auto v = spvalue.lock();
+		TEST_ASSERT(spvalue.trylock() == spvalue.locked_state);
+
+		std::atomic<uint32_t> seen { 0 };
+		threading::spin_lock  sl;
+		uint64_t			  sl_count = 0;
+		{
+			threading::thread_group waiters;
+			waiters.spawn(4, [&]() {
+				seen += spvalue.peek() == v + 1 ? 1 : 0;
+				spvalue.unlock(spvalue.lock());
+				for (uint32_t i = 0; i < 1000; i++)
+				{
+					std::lock_guard<threading::spin_lock> _(sl);
+					sl_count++;
+				}
+			});
+			threading::utils::sleep_thread(20);
+			TEST_ASSERT(spvalue.islocked());
+			spvalue.unlock(v + 1);
+		}
+		TEST_ASSERT(seen == 4);
+		TEST_ASSERT(sl_count == 4000);
+		TEST_ASSERT(spvalue.peek() == v + 1);
+	}
+
+	// lock_if() on a predicate that stays false for a long time parks instead of spinning, whatever the word size
+	spin_value_lock_if_wait<uint32_t>(8);
+	spin_value_lock_if_wait<uint64_t>(8);
+	spin_value_lock_if_wait<uint8_t>(8);
+
+	// the lock stays a single word, waiters on a value wait in the parking slots
+	static_assert(sizeof(threading::spin_value_lock<uint8_t>) == 1, "one word");
+	static_assert(sizeof(threading::spin_value_lock<uint32_t>) == 4, "one word");
+	static_assert(sizeof(threading::spin_value_lock<uint64_t>) == 8, "one word");
 }
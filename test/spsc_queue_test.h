@@ -0,0 +1,60 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_spsc_queue_order()
+{
+	threading::spsc_queue<uint64_t> q(16);
+	TEST_ASSERT(q.capacity() == 16);
+
+	const uint64_t count = 200000;
+	uint64_t	   expected = 0;
+	{
+		threading::thread_group consumer;
+		consumer.spawn(1, [&]() {
+			uint64_t v;
+			while (q.pop(v))
+			{
+				TEST_ASSERT(v == expected);
+				expected++;
+			}
+		});
+
+		for (uint64_t i = 0; i < count; i++)
+			TEST_ASSERT(q.push(i));
+		q.close();
+	}
+	TEST_ASSERT(expected == count);
+	TEST_ASSERT(q.push(uint64_t(1)) == false);
+}
+
+void test_spsc_queue_batch()
+{
+	threading::spsc_queue<std::unique_ptr<uint64_t>, false> q(8);
+
+	// staged items are invisible until published
+	for (uint64_t i = 0; i < 8; i++)
+		TEST_ASSERT(q.try_stage(std::make_unique<uint64_t>(i)));
+	TEST_ASSERT(q.try_stage(std::make_unique<uint64_t>(8)) == false);
+
+	std::unique_ptr<uint64_t> out;
+	TEST_ASSERT(q.try_pop(out) == false);
+	q.publish();
+
+	TEST_ASSERT(q.try_pop(out));
+	TEST_ASSERT(*out == 0);
+
+	uint64_t next = 1;
+	TEST_ASSERT(q.consume_all([&](std::unique_ptr<uint64_t>&& v) { TEST_ASSERT(*v == next++); }) == 7);
+	TEST_ASSERT(q.consume_all([&](std::unique_ptr<uint64_t>&&) {}) == 0);
+
+	// wraps around, items left in the queue are destroyed with it
+	for (uint64_t i = 0; i < 5; i++)
+		TEST_ASSERT(q.try_push(std::make_unique<uint64_t>(i)));
+}
+
+void test_spsc_queue()
+{
+	TEST_FUNCTION(test_spsc_queue_order);
+	TEST_FUNCTION(test_spsc_queue_batch);
+}
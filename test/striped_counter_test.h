@@ -0,0 +1,41 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_striped_counter()
+{
+	threading::striped_counter<uint64_t> sum;
+	threading::striped_max<int64_t>		 max;
+	threading::striped_min<int64_t>		 min;
+
+	TEST_ASSERT(sum.load() == 0);
+	TEST_ASSERT(max.load() == std::numeric_limits<int64_t>::lowest());
+
+	{
+		threading::thread_group	 threads;
+		std::atomic<int64_t>	 next { 0 };
+		threads.spawn(8, [&]() {
+			int64_t id = next++;
+			for (int64_t i = 0; i < 10000; i++)
+			{
+				sum += 1;
+				max.update(id * 10000 + i);
+				min.update(-(id * 10000 + i));
+			}
+		});
+	}
+	TEST_ASSERT(sum.load() == 80000);
+	TEST_ASSERT(max.load() == 79999);
+	TEST_ASSERT(min.load() == -79999);
+
+	sum.reset();
+	++sum;
+	TEST_ASSERT(sum.load() == 1);
+
+	// a single cell behaves like a plain atomic
+	threading::striped_counter<uint32_t> single(1);
+	TEST_ASSERT(single.cell_count() == 1);
+	single.add(5);
+	single.sub(2);
+	TEST_ASSERT(single.load() == 3);
+}
@@ -0,0 +1,104 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_task_graph_diamond()
+{
+	threading::worker_pool pool(4);
+	threading::task_graph  graph;
+
+	std::atomic<uint32_t> a { 0 };
+	std::atomic<uint32_t> b { 0 };
+	std::atomic<uint32_t> c { 0 };
+	std::atomic<uint32_t> d { 0 };
+
+	auto& na = graph.emplace([&]() { a++; });
+	auto& nb = graph.emplace([&]() {
+		TEST_ASSERT(a.load() == b.load() + 1);
+		b++;
+	});
+	auto& nc = graph.emplace([&]() {
+		TEST_ASSERT(a.load() == c.load() + 1);
+		c++;
+	});
+	auto& nd = graph.emplace([&]() {
+		TEST_ASSERT(b.load() == d.load() + 1);
+		TEST_ASSERT(c.load() == d.load() + 1);
+		d++;
+	});
+
+	na.precede(nb, nc);
+	nd.succeed(nb);
+	nd.succeed(nc);
+
+	const uint32_t runs = 100;
+	for (uint32_t i = 0; i < runs; i++)
+		graph.run(pool);
+
+	TEST_ASSERT(d.load() == runs);
+}
+
+void test_task_graph_wide()
+{
+	threading::worker_pool pool(8);
+	threading::task_graph  graph;
+
+	std::atomic<uint64_t> sum { 0 };
+
+	auto& root = graph.emplace([]() {});
+	auto& sink = graph.emplace([&]() { TEST_ASSERT(sum.load() == 256 * 255 / 2); });
+	for (uint64_t i = 0; i < 256; i++)
+	{
+		auto& n = graph.emplace([&, i]() { sum += i; });
+		root.precede(n);
+		n.precede(sink);
+	}
+
+	for (std::size_t i = 0; i < 16; i++)
+	{
+		sum = 0;
+		graph.run_async(pool);
+		graph.wait();
+	}
+}
+
+// a root does not make a graph runnable, a cycle further down would never complete
+void test_task_graph_cycle()
+{
+	threading::task_graph graph;
+	auto&				  a = graph.emplace([]() {});
+	auto&				  b = graph.emplace([]() {});
+	auto&				  c = graph.emplace([]() {});
+	a.precede(b);
+	b.precede(c);
+	TEST_ASSERT(graph.acyclic());
+
+	c.precede(b);
+	TEST_ASSERT(graph.acyclic() == false);
+	TEST_ASSERT(graph.acyclic() == false);
+
+	threading::task_graph all_cycle;
+	auto&				  x = all_cycle.emplace([]() {});
+	auto&				  y = all_cycle.emplace([]() {});
+	x.precede(y);
+	y.precede(x);
+	TEST_ASSERT(all_cycle.acyclic() == false);
+
+	// the check leaves the graph runnable
+	threading::worker_pool pool(2);
+	threading::task_graph  line;
+	std::atomic<uint32_t>  steps { 0 };
+	auto&				   first = line.emplace([&]() { TEST_ASSERT(steps++ == 0); });
+	auto&				   second = line.emplace([&]() { TEST_ASSERT(steps++ == 1); });
+	first.precede(second);
+	TEST_ASSERT(line.acyclic());
+	TEST_ASSERT(line.run(pool));
+	TEST_ASSERT(steps.load() == 2);
+}
+
+void test_task_graph()
+{
+	TEST_FUNCTION(test_task_graph_diamond);
+	TEST_FUNCTION(test_task_graph_wide);
+	TEST_FUNCTION(test_task_graph_cycle);
+}
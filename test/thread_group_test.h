@@ -0,0 +1,73 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_thread_group_stats()
+{
+	const threading::thread_stats self = threading::thread_group::current_thread_stats();
+	std::cout << "main thread cpu " << self.cpu_time_ns / 1000 << " us, switches " << self.voluntary_switches << "/" << self.involuntary_switches
+			  << ", migrations " << self.migrations << ", cpu " << self.current_cpu << std::endl;
+#if DEV_PLATFORM_LIN()
+	TEST_ASSERT(self.os_id > 0);
+	TEST_ASSERT(self.cpu_time_ns > 0);
+	TEST_ASSERT(self.current_cpu >= 0);
+#endif
+
+	std::atomic<bool>	  release { false };
+	std::atomic<uint32_t> busy { 0 };
+	threading::thread_group threads;
+	threads.spawn_named("stats", 2, [&]() {
+		// burn some cpu, then block a few times
+		const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(5);
+		while (std::chrono::steady_clock::now() < until)
+			;
+		busy++;
+		while (release.load() == false)
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+	});
+	threads.spawn(1, [&]() {});
+	TEST_ASSERT(threads.size() == 3);
+
+	while (busy.load() < 2)
+		std::this_thread::yield();
+
+	const std::vector<threading::thread_stats> running = threads.stats();
+	TEST_ASSERT(running.size() == 3);
+	TEST_ASSERT(running[0].name == "stats-0");
+	TEST_ASSERT(running[1].name == "stats-1");
+	TEST_ASSERT(running[2].name.empty());
+	for (std::size_t i = 0; i < 2; i++)
+	{
+		TEST_ASSERT(running[i].finished == false);
+#if DEV_PLATFORM_LIN()
+		TEST_ASSERT(running[i].os_id > 0 && running[i].os_id != self.os_id);
+		TEST_ASSERT(running[i].cpu_time_ns > 0);
+		TEST_ASSERT(running[i].current_cpu >= 0);
+#endif
+	}
+
+	release = true;
+	for (std::size_t i = 0; i < threads.size(); i++)
+	{
+		while (threads.stats(i).finished == false)
+			std::this_thread::yield();
+	}
+
+	const std::vector<threading::thread_stats> done = threads.stats();
+	for (std::size_t i = 0; i < 2; i++)
+	{
+		std::cout << done[i].name << " cpu " << done[i].cpu_time_ns / 1000 << " us, switches " << done[i].voluntary_switches << "/"
+				  << done[i].involuntary_switches << ", migrations " << done[i].migrations << ", cpu " << done[i].current_cpu << std::endl;
+		TEST_ASSERT(done[i].name == running[i].name);
+		TEST_ASSERT(done[i].cpu_time_ns >= running[i].cpu_time_ns);
+#if DEV_PLATFORM_LIN()
+		TEST_ASSERT(done[i].os_id == running[i].os_id);
+		TEST_ASSERT(done[i].voluntary_switches > 0); // slept
+#endif
+	}
+
+	threading::thread_group moved;
+	moved.swap(threads);
+	TEST_ASSERT(threads.size() == 0 && threads.stats().empty());
+	TEST_ASSERT(moved.stats(0).name == "stats-0");
+}
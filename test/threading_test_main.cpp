@@ -1,15 +1,53 @@
 
-#include "threading_grind.h"
 #include "async_pipe_test.h"
 #include "multi_read_spinlock_test.h"
 #include "spin_value_lock_test.h"
+#include "task_graph_test.h"
+#include "parallel_algorithms_test.h"
+#include "coro_task_test.h"
+#include "future_test.h"
+#include "timer_wheel_test.h"
+#include "object_pool_test.h"
+#include "unique_task_test.h"
+#include "spsc_queue_test.h"
+#include "pipeline_test.h"
+#include "cache_padded_test.h"
+#include "striped_counter_test.h"
+#include "lock_table_test.h"
+#include "concurrent_hash_map_test.h"
+#include "event_count_test.h"
+#include "locked_wait_test.h"
+#include "elastic_consumers_test.h"
+#include "trace_test.h"
+#include "thread_group_test.h"
+#include "perf_counters_test.h"
+#include "memory_bench_test.h"
 
 void threading_test_main()
 {
 	TEST_FUNCTION(test_multi_read_spin_lock);
 	TEST_FUNCTION(test_spin_value_lock);
 	TEST_FUNCTION(test_async_pipe);
-	TEST_FUNCTION(test_thread_grind);
+	TEST_FUNCTION(test_task_graph);
+	TEST_FUNCTION(test_parallel_algorithms);
+	TEST_FUNCTION(test_coro_task);
+	TEST_FUNCTION(test_future);
+	TEST_FUNCTION(test_timer_wheel);
+	TEST_FUNCTION(test_object_pool);
+	TEST_FUNCTION(test_unique_task);
+	TEST_FUNCTION(test_spsc_queue);
+	TEST_FUNCTION(test_pipeline);
+	TEST_FUNCTION(test_cache_padded);
+	TEST_FUNCTION(test_striped_counter);
+	TEST_FUNCTION(test_lock_table);
+	TEST_FUNCTION(test_concurrent_hash_map);
+	TEST_FUNCTION(test_event_count);
+	TEST_FUNCTION(test_locked_wait);
+	TEST_FUNCTION(test_elastic_consumers);
+	TEST_FUNCTION(test_trace);
+	TEST_FUNCTION(test_thread_group_stats);
+	TEST_FUNCTION(test_perf_counters);
+	TEST_FUNCTION(test_memory_bench);
 }
 
 TEST_MAIN(threading_test_main);
@@ -0,0 +1,86 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_timer_wheel_one_shot()
+{
+	threading::timer_wheel wheel(1);
+
+	const uint32_t		  count = 2000;
+	std::atomic<uint32_t> fired { 0 };
+	std::atomic<uint32_t> early { 0 };
+
+	std::vector<threading::timer_wheel::timer_id> ids;
+	auto										  start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t delay = 1 + (i * 7919) % 300;
+		ids.push_back(wheel.schedule_after(delay, [&, delay, start]() {
+			auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+			if (elapsed.count() < delay)
+				early++;
+			fired++;
+		}));
+	}
+
+	// cancel every other timer
+	uint32_t cancelled = 0;
+	for (std::size_t i = 0; i < ids.size(); i += 2)
+		cancelled += wheel.cancel(ids[i]) ? 1 : 0;
+
+	while (wheel.size() > 0)
+		threading::utils::sleep_thread(10);
+
+	TEST_ASSERT(early.load() == 0);
+	TEST_ASSERT(fired.load() + cancelled == count);
+	TEST_ASSERT(wheel.cancel(ids[1]) == false);
+}
+
+void test_timer_wheel_periodic()
+{
+	threading::timer_wheel wheel(1);
+
+	std::atomic<uint32_t> ticks { 0 };
+	auto				  id = wheel.schedule_every(2, [&]() { ticks++; });
+
+	while (ticks.load() < 10)
+		threading::utils::sleep_thread(1);
+
+	TEST_ASSERT(wheel.cancel(id));
+	TEST_ASSERT(wheel.cancel(id) == false);
+	TEST_ASSERT(wheel.size() == 0);
+
+	// long delays go through the upper levels
+	std::atomic<bool> long_fired { false };
+	auto			  long_id = wheel.schedule_after(1000 * 60 * 60, [&]() { long_fired = true; });
+	TEST_ASSERT(wheel.size() == 1);
+	TEST_ASSERT(wheel.cancel(long_id));
+	TEST_ASSERT(long_fired.load() == false);
+}
+
+void test_timer_wheel_post()
+{
+	threading::timer_wheel			wheel(1);
+	threading::async_pipe<uint32_t> p;
+	threading::thread_group			threads;
+
+	std::atomic<uint32_t> sum { 0 };
+	threads.spawn(2, [&]() { p.consume_loop_or_wait([&](const uint32_t v) { sum += v; }); });
+
+	for (uint32_t i = 1; i <= 100; i++)
+		wheel.post_after(i % 20, p, uint32_t(i));
+
+	while (wheel.size() > 0)
+		threading::utils::sleep_thread(5);
+	p.wait_for_empty();
+
+	TEST_ASSERT(sum.load() == 5050);
+	p.evict(threads.size(), 0);
+}
+
+void test_timer_wheel()
+{
+	TEST_FUNCTION(test_timer_wheel_one_shot);
+	TEST_FUNCTION(test_timer_wheel_periodic);
+	TEST_FUNCTION(test_timer_wheel_post);
+}
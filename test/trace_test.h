@@ -0,0 +1,75 @@
+#include <threading.h>
+
+#include <iostream>
+#include <sstream>
+
+#if defined(THREADING_TRACE)
+// rings in the dump, threads that recorded at least once and did not hand their ring on
+inline std::size_t trace_ring_count()
+{
+	std::ostringstream out;
+	threading::trace::dump(out);
+	const std::string json = out.str();
+	std::size_t		  max_tid = 0;
+	for (std::size_t at = json.find("\"tid\":"); at != std::string::npos; at = json.find("\"tid\":", at + 1))
+		max_tid = std::max<std::size_t>(max_tid, std::stoul(json.substr(at + 6)));
+	return max_tid;
+}
+#endif
+
+void test_trace()
+{
+	threading::trace::clear();
+	threading::trace::set_thread_name("test \"main\"");
+	{
+		THREADING_TRACE_SCOPE("outer");
+		THREADING_TRACE_INSTANT("mark");
+
+		threading::latch		l(2);
+		threading::thread_group threads;
+		threads.spawn(1, [&]() {
+			threading::trace::set_thread_name("helper");
+			l.arrive_and_wait();
+		});
+		l.arrive_and_wait();
+	}
+
+	std::ostringstream out;
+	threading::trace::dump(out);
+	const std::string json = out.str();
+	TEST_ASSERT(json.find("{\"traceEvents\":[") == 0);
+
+#if defined(THREADING_TRACE)
+	TEST_ASSERT(json.find("\"name\":\"outer\",\"pid\":1") != std::string::npos);
+	TEST_ASSERT(json.find("\"name\":\"mark\"") != std::string::npos);
+	TEST_ASSERT(json.find("\"name\":\"latch wait\"") != std::string::npos);
+	TEST_ASSERT(json.find("test \\\"main\\\"") != std::string::npos);
+	TEST_ASSERT(json.find("\"helper\"") != std::string::npos);
+
+	TEST_ASSERT(json.find("\"ph\":\"B\"") != std::string::npos && json.find("\"ph\":\"E\"") != std::string::npos);
+
+	// rings of exited threads are reused, thread churn does not add rings
+	{
+		threading::thread_group threads;
+		threads.spawn(1, []() { THREADING_TRACE_INSTANT("churn"); });
+	}
+	const std::size_t rings = trace_ring_count();
+	for (uint32_t i = 0; i < 50; i++)
+	{
+		threading::thread_group threads;
+		threads.spawn(1, []() { THREADING_TRACE_INSTANT("churn"); });
+	}
+	TEST_ASSERT(trace_ring_count() == rings);
+
+	// a scope is two events of one timestamp each
+	const uint32_t count = 1000000;
+	ttf::timer	   timer;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		THREADING_TRACE_SCOPE("bench");
+	}
+	std::cout << "\ntrace event: " << double(timer.get_nanoseconds()) / (2.0 * count) << " ns\n";
+#else
+	TEST_ASSERT(json.find("outer") == std::string::npos);
+#endif
+}
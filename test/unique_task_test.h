@@ -0,0 +1,146 @@
+#include <threading.h>
+
+#include <iostream>
+
+void test_unique_task_storage()
+{
+	struct counted
+	{
+		std::atomic<uint32_t>* destroyed;
+		counted(std::atomic<uint32_t>* d)
+			: destroyed(d)
+		{
+		}
+		counted(counted&& other) noexcept
+			: destroyed(other.destroyed)
+		{
+			other.destroyed = nullptr;
+		}
+		~counted()
+		{
+			if (destroyed != nullptr)
+				(*destroyed)++;
+		}
+	};
+
+	uint64_t value = 0;
+	auto	 small = [&value]() { value++; };
+	static_assert(threading::unique_task::stored_inline<decltype(small)>, "small lambdas are stored inline");
+	static_assert(sizeof(threading::unique_task) == threading::cache_line_size, "one cache line");
+
+	threading::unique_task a(small);
+	threading::unique_task b(std::move(a));
+	TEST_ASSERT(bool(a) == false);
+	b();
+	TEST_ASSERT(value == 1);
+
+	// move-only capture
+	auto				   owned = std::make_unique<uint64_t>(41);
+	threading::unique_task c([&value, p = std::move(owned)]() { value += *p; });
+	c();
+	TEST_ASSERT(value == 42);
+
+	// out-of-line capture, destroyed exactly once
+	std::atomic<uint32_t> destroyed { 0 };
+	{
+		uint64_t big[16] = { 1 };
+		auto	 large = [&value, big, cnt = counted(&destroyed)]() { value += big[0]; };
+		static_assert(threading::unique_task::stored_inline<decltype(large)> == false, "large lambdas go out of line");
+
+		threading::unique_task d(std::move(large));
+		threading::unique_task e;
+		e = std::move(d);
+		e();
+		TEST_ASSERT(value == 43);
+		e = nullptr;
+		TEST_ASSERT(destroyed.load() == 1);
+	}
+	TEST_ASSERT(destroyed.load() == 1);
+}
+
+void test_unique_task_executors()
+{
+	std::atomic<uint64_t> sum { 0 };
+	{
+		threading::task_pipe p;
+
+		threading::thread_group consumers;
+		consumers.spawn(4, [&]() { p.consume_loop_or_wait([](threading::unique_task&& t) { t(); }); });
+
+		for (uint64_t i = 1; i <= 1000; i++)
+		{
+			auto v = std::make_unique<uint64_t>(i);
+			p.push_back([&sum, v = std::move(v)]() { sum += *v; });
+		}
+		p.close_and_wait();
+	}
+	TEST_ASSERT(sum.load() == 1000 * 1001 / 2);
+
+	sum = 0;
+	{
+		threading::worker_pool	pool(4);
+		threading::join_counter done(100);
+		for (uint64_t i = 1; i <= 100; i++)
+		{
+			auto v = std::make_unique<uint64_t>(i);
+			pool.submit([&, v = std::move(v)]() {
+				sum += *v;
+				done.done();
+			});
+		}
+		pool.wait(done);
+	}
+	TEST_ASSERT(sum.load() == 100 * 101 / 2);
+}
+
+// out-of-line tasks built on a producer and destroyed on a consumer: blocks flow back to the producer, the pool stops growing
+void test_unique_task_round_trip()
+{
+	struct payload
+	{
+		std::atomic<uint64_t>* sum;
+		uint64_t			   big[16];
+
+		void operator()()
+		{
+			*sum += big[0];
+		}
+	};
+	static_assert(threading::unique_task::stored_inline<payload> == false, "goes to the block pool");
+	using blocks = threading::detail::block_pool<threading::detail::task_block_size(sizeof(payload))>;
+
+	std::atomic<uint64_t> sum { 0 };
+
+	auto run = [&](const uint64_t count) {
+		threading::spsc_queue<threading::unique_task> q(64);
+		threading::thread_group						  consumer;
+		consumer.spawn(1, [&]() {
+			threading::unique_task t;
+			while (q.pop(t))
+			{
+				t();
+				t = nullptr;
+			}
+		});
+		for (uint64_t i = 1; i <= count; i++)
+			q.push(threading::unique_task(payload { &sum, { i } }));
+		q.close();
+	};
+
+	run(1000);
+	const std::size_t slabs = blocks::pool().slab_count();
+	sum = 0;
+	run(100000);
+	TEST_ASSERT(sum.load() == 100000ull * 100001 / 2);
+
+	// at most queue capacity + one remote batch + a few in hand are out at once
+	const std::size_t in_flight = 64 + threading::object_pool_base::remote_batch + 4;
+	TEST_ASSERT(blocks::pool().slab_count() - slabs <= in_flight / 64 + 1);
+}
+
+void test_unique_task()
+{
+	TEST_FUNCTION(test_unique_task_storage);
+	TEST_FUNCTION(test_unique_task_executors);
+	TEST_FUNCTION(test_unique_task_round_trip);
+}